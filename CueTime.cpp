@@ -0,0 +1,153 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+//---------------------------------------------------------------------------
+#include "CueTime.h"
+#include "Digits2.h"
+#include <cstring>
+//---------------------------------------------------------------------------
+
+//***************************************************************************
+// Constructor/Destructor
+//***************************************************************************
+
+//---------------------------------------------------------------------------
+CueTime::CueTime (uint64_t Num, uint64_t Inc_, uint64_t Den_)
+:   Den(Den_?Den_:1),
+    Text_Seconds((uint64_t)-1),
+    Text_Begin(MaxSize)
+{
+    SetInc(Inc_);
+
+    Seconds=Num/Den;
+    Remainder=Num%Den;
+    uint64_t Temp=Remainder*1000+Den/2;
+    Milliseconds=Temp/Den;
+    Milliseconds_Error=Temp%Den;
+
+    Text[MaxSize-10]=':';
+    Text[MaxSize-7]=':';
+    Text[MaxSize-4]='.';
+    Format();
+}
+
+//***************************************************************************
+// Helpers
+//***************************************************************************
+
+//---------------------------------------------------------------------------
+void CueTime::Next()
+{
+    Seconds+=Inc_Seconds;
+    Remainder+=Inc_Remainder;
+    Milliseconds+=Inc_Milliseconds;
+    Milliseconds_Error+=Inc_Milliseconds_Error;
+    if (Milliseconds_Error>=Den)
+    {
+        Milliseconds_Error-=Den;
+        Milliseconds++;
+    }
+    if (Remainder>=Den)
+    {
+        Remainder-=Den;
+        Seconds++;
+        Milliseconds-=1000;
+    }
+    Format();
+}
+
+//---------------------------------------------------------------------------
+void CueTime::Next(uint64_t Inc_)
+{
+    if (Inc_!=Inc)
+        SetInc(Inc_);
+    Next();
+}
+
+//***************************************************************************
+// Internal
+//***************************************************************************
+
+//---------------------------------------------------------------------------
+void CueTime::SetInc(uint64_t Inc_)
+{
+    Inc=Inc_;
+    Inc_Seconds=Inc/Den;
+    Inc_Remainder=Inc%Den;
+    Inc_Milliseconds=Inc_Remainder*1000/Den;
+    Inc_Milliseconds_Error=Inc_Remainder*1000%Den;
+}
+
+//---------------------------------------------------------------------------
+void CueTime::Format()
+{
+    char* End=Text+MaxSize;
+
+    //Milliseconds, rounded value may be 1000
+    uint64_t S=Seconds;
+    uint64_t MS=Milliseconds;
+    if (MS>=1000)
+    {
+        S++;
+        MS-=1000;
+    }
+    End[-3]='0'+(char)(MS/100);
+    memcpy(End-2, Digits2+(MS%100)*2, 2);
+
+    if (S==Text_Seconds)
+        return;
+
+    //Next second, only the seconds digits are patched
+    if (S==Text_Seconds+1 && Text_Begin!=MaxSize)
+    {
+        Text_Seconds=S;
+        if (End[-5]!='9')
+        {
+            End[-5]++;
+            return;
+        }
+        if (End[-6]!='5')
+        {
+            End[-6]++;
+            End[-5]='0';
+            return;
+        }
+    }
+
+    //Full computing
+    Text_Seconds=S;
+    uint64_t H=S/3600;
+    uint32_t MMSS=(uint32_t)(S%3600);
+    memcpy(End-6, Digits2+(MMSS%60)*2, 2);
+    memcpy(End-9, Digits2+(MMSS/60)*2, 2);
+    char* HH=End-10;
+    do
+    {
+        HH-=2;
+        memcpy(HH, Digits2+(H%100)*2, 2);
+        H/=100;
+    }
+    while (H);
+    if (HH[0]=='0' && HH+2<End-10) //Hours are at least 2 digits
+        HH++;
+    Text_Begin=HH-Text;
+}
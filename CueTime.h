@@ -0,0 +1,59 @@
+/*
+ * Tiny WebVTT cue time stamp formatter
+ */
+
+//---------------------------------------------------------------------------
+#ifndef CueTimeH
+#define CueTimeH
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+//---------------------------------------------------------------------------
+
+//***************************************************************************
+// Class CueTime
+//***************************************************************************
+
+// Time stamp in HH:MM:SS.mmm format, incremented by a rational step
+// The end of a cue is the start of the next one, so each time stamp is computed and formatted only once
+class CueTime
+{
+public:
+    //Constructor/Destructor
+    CueTime (uint64_t Num=0, uint64_t Inc=0, uint64_t Den=1); // Start at Num/Den seconds, each step is Inc/Den seconds
+
+    //Helpers
+    void Next();
+    void Next(uint64_t Inc); // Step is Inc/Den seconds, faster if same as previous step
+    const char* data() const { return Text+Text_Begin; }
+    size_t size() const { return MaxSize-Text_Begin; }
+
+    static const size_t MaxSize=32;
+
+private:
+    void SetInc(uint64_t Inc);
+    void Format();
+
+    //Increment
+    uint64_t Den;
+    uint64_t Inc;
+    uint64_t Inc_Seconds;
+    uint64_t Inc_Remainder;
+    uint64_t Inc_Milliseconds;
+    uint64_t Inc_Milliseconds_Error;
+
+    //Current value, Milliseconds*Den+Milliseconds_Error == Remainder*1000+Den/2
+    uint64_t Seconds;
+    uint64_t Remainder;
+    uint64_t Milliseconds;
+    uint64_t Milliseconds_Error;
+
+    //Formatted value, aligned on the end of Text, "HH:MM:SS." is patched only when seconds change
+    uint64_t Text_Seconds;
+    size_t Text_Begin;
+    char Text[MaxSize];
+};
+
+#endif
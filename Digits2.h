@@ -0,0 +1,14 @@
+/*
+ * Internal table of 2-digit decimal numbers, shared by the formatters of the library
+ */
+
+//---------------------------------------------------------------------------
+#ifndef Digits2H
+#define Digits2H
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// "00" to "99", number N is at Digits2+N*2 (defined in TimeCode.cpp)
+extern const char Digits2[201];
+
+#endif
@@ -22,7 +22,7 @@ SOFTWARE.
 
 //---------------------------------------------------------------------------
 #include "TimeCode.h"
-#include <sstream>
+#include "Digits2.h"
 #include <limits>
 //---------------------------------------------------------------------------
 
@@ -539,87 +539,225 @@ bool TimeCode::FromString(const char* Value, size_t Length)
     return true;
 }
 
+//---------------------------------------------------------------------------
+// 8 chars in an integer, the first char in the lowest byte
+static inline uint64_t Load8(const char* Value)
+{
+    uint64_t Result=0;
+    for (int i=7; i>=0; i--)
+        Result=(Result<<8)|(unsigned char)Value[i];
+    return Result;
+}
+
+//---------------------------------------------------------------------------
+size_t TimeCode::FromStrings(const char* const* Values, const size_t* Lengths, size_t Count, TimeCode* Results) const
+{
+    //hh:mm:ss:ff and hh:mm:ss;ff values are checked and converted 8 chars at a time, "hh:mm:ss" then "mm:ss;ff"
+    //After a xor with "00:00:00", digits are 0-9 and separators are 0 (1 for ';'), then each byte plus 10 times the previous one is a 2-digit number
+    const uint64_t Pattern=0x30303A30303A3030ULL;
+    const uint64_t HighBits=0x8080808080808080ULL;
+    const uint64_t Over9=0x7676767676767676ULL;
+    size_t ErrorCount=0;
+    for (size_t i=0; i<Count; i++)
+    {
+        const char* Value=Values[i];
+        TimeCode& Result=Results[i];
+        Result=*this;
+        if (Lengths[i]==11)
+        {
+            uint64_t First=Load8(Value)^Pattern;
+            uint64_t Last=Load8(Value+3)^Pattern;
+            if (!(((First+Over9)|First|(Last+Over9)|Last)&HighBits)
+             && !(First&0x0000FF0000FF0000ULL)
+             && !(Last&0x0000FE0000FF0000ULL))
+            {
+                uint64_t FirstPairs=First*10+(First>>8);
+                uint64_t LastPairs=Last*10+(Last>>8);
+                Result.Hours=(uint32_t)(FirstPairs&0xFF);
+                Result.Minutes=(uint8_t)(FirstPairs>>24);
+                Result.Seconds=(uint8_t)(FirstPairs>>48);
+                Result.Frames=(uint32_t)((LastPairs>>48)&0xFF);
+                Result.Flags.set(DropFrame, (Last>>40)&1);
+                Result.Flags.set(FramesPerSecond_Is1001);
+                Result.Flags.reset(IsSecondField);
+                Result.Flags.reset(IsNegative);
+                Result.Flags.reset(HasNoFramesInfo);
+                Result.Flags.reset(IsTime);
+                Result.Flags.set(IsValid);
+                continue;
+            }
+        }
+        if (Result.FromString(Value, Lengths[i]))
+            ErrorCount++;
+    }
+    return ErrorCount;
+}
+
+//---------------------------------------------------------------------------
+static inline char* WriteNumber(char* Value, uint64_t Number)
+{
+    char Temp[20];
+    char* End=Temp+sizeof(Temp);
+    char* Begin=End;
+    do
+    {
+        *--Begin='0'+Number%10;
+        Number/=10;
+    }
+    while (Number);
+    memcpy(Value, Begin, End-Begin);
+    return Value+(End-Begin);
+}
+
 //---------------------------------------------------------------------------
 string TimeCode::ToString() const
+{
+    char Value[ToString_MaxSize];
+    return string(Value, ToString(Value));
+}
+
+//---------------------------------------------------------------------------
+size_t TimeCode::ToString(char* Value) const
 {
     if (!HasValue())
-        return string();
-    string TC;
+        return 0;
+    char* TC=Value;
     if (Flags.test(IsNegative))
-        TC+='-';
+        *TC++='-';
     uint8_t HH=Hours;
     if (HH>100)
     {
-        TC+=to_string(HH/100);
+        TC=WriteNumber(TC, HH/100);
         HH%=100;
     }
-    TC+=('0'+HH/10);
-    TC+=('0'+HH%10);
-    TC+=':';
+    *TC++=('0'+HH/10);
+    *TC++=('0'+HH%10);
+    *TC++=':';
     uint8_t MM=Minutes;
     if (MM>100)
     {
-        TC+=('0'+MM/100);
+        *TC++=('0'+MM/100);
         MM%=100;
     }
-    TC+=('0'+MM/10);
-    TC+=('0'+MM%10);
-    TC+=':';
+    *TC++=('0'+MM/10);
+    *TC++=('0'+MM%10);
+    *TC++=':';
     uint8_t SS=Seconds;
     if (SS>100)
     {
-        TC+=('0'+SS/100);
+        *TC++=('0'+SS/100);
         SS%=100;
     }
-    TC+=('0'+SS/10);
-    TC+=('0'+SS%10);
+    *TC++=('0'+SS/10);
+    *TC++=('0'+SS%10);
     bool d=Flags.test(DropFrame);
     bool t=Flags.test(IsTime);
     if (!t && d)
-        TC+=';';
+        *TC++=';';
     if (t)
     {
         int AfterCommaMinus1;
         AfterCommaMinus1=PowersOf10_Size;
-        auto FrameRate=FramesMax+1;
+        int64_t FrameRate=(int64_t)FramesMax+1; // Same signedness as PowersOf10, and no wrap if FramesMax is the max value
         while ((--AfterCommaMinus1)>=0 && PowersOf10[AfterCommaMinus1]!=FrameRate);
-        TC+='.';
+        *TC++='.';
         if (AfterCommaMinus1<0)
         {
-            stringstream s;
-            s<<Frames;
-            TC+=s.str();
-            TC+='S';
-            s.str(string());
-            s<<FrameRate;
-            TC+=s.str();
+            TC=WriteNumber(TC, Frames);
+            *TC++='S';
+            TC=WriteNumber(TC, FrameRate);
         }
         else
         {
             for (int i=0; i<=AfterCommaMinus1;i++)
-                TC+='0'+(Frames/(i==AfterCommaMinus1?1:PowersOf10[AfterCommaMinus1-i-1])%10);
+                *TC++='0'+(Frames/(i==AfterCommaMinus1?1:PowersOf10[AfterCommaMinus1-i-1])%10);
         }
     }
     else if (!Flags.test(HasNoFramesInfo))
     {
         if (!d)
-            TC+=':';
+            *TC++=':';
         auto FF=Frames;
         if (FF>=100)
         {
-            TC+=to_string(FF/100);
+            TC=WriteNumber(TC, FF/100);
             FF%=100;
         }
-        TC+=('0'+(FF/10));
-        TC+=('0'+(FF%10));
+        *TC++=('0'+(FF/10));
+        *TC++=('0'+(FF%10));
         if (Flags.test(MustUseSecondField) || Flags.test(IsSecondField))
         {
-            TC+='.';
-            TC+=('0'+Flags.test(IsSecondField));
+            *TC++='.';
+            *TC++=('0'+Flags.test(IsSecondField));
         }
     }
 
-    return TC;
+    return TC-Value;
+}
+
+//---------------------------------------------------------------------------
+const char Digits2[201]=
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+//---------------------------------------------------------------------------
+size_t TimeCode::ToStrings(char* Values, size_t Count, size_t* Ends)
+{
+    size_t Size=0;
+    size_t i=0;
+    while (i<Count)
+    {
+        //Values not in hh:mm:ss:ff or hh:mm:ss;ff form are formatted one by one
+        if (!Flags.test(IsValid)
+         || Flags.test(IsNegative) || Flags.test(IsTime) || Flags.test(HasNoFramesInfo) || Flags.test(MustUseSecondField) || Flags.test(IsSecondField)
+         || Hours>=100 || Minutes>=60 || Seconds>=60 || Frames>FramesMax || FramesMax>=1000)
+        {
+            Size+=ToString(Values+Size);
+            Ends[i++]=Size;
+            PlusOne();
+            continue;
+        }
+
+        //Within a second, only the frame number changes: the "hh:mm:ss:" prefix is formatted once then copied
+        char Prefix[9];
+        memcpy(Prefix, Digits2+Hours*2, 2);
+        Prefix[2]=':';
+        memcpy(Prefix+3, Digits2+Minutes*2, 2);
+        Prefix[5]=':';
+        memcpy(Prefix+6, Digits2+Seconds*2, 2);
+        Prefix[8]=Flags.test(DropFrame)?';':':';
+        uint32_t Last=FramesMax;
+        if (Count-i<=Last-Frames)
+            Last=Frames+(uint32_t)(Count-i)-1;
+        for (uint32_t FF=Frames; FF<=Last; FF++)
+        {
+            char* TC=Values+Size;
+            memcpy(TC, Prefix, 9);
+            TC+=9;
+            uint32_t FF2=FF;
+            if (FF2>=100)
+            {
+                *TC++='0'+FF2/100;
+                FF2%=100;
+            }
+            memcpy(TC, Digits2+FF2*2, 2);
+            Size=TC+2-Values;
+            Ends[i++]=Size;
+        }
+
+        //Carry to the next second (with the dropped frame numbers) only at the end of the second
+        Frames=Last;
+        PlusOne();
+    }
+    return Size;
 }
 
 //---------------------------------------------------------------------------
@@ -659,11 +797,193 @@ int64_t TimeCode::ToMilliseconds() const
     if (!HasValue())
         return 0;
 
-    int64_t Den=((((uint64_t)FramesMax)+1)*(Flags.test(MustUseSecondField)?2:1));
-    int64_t MS=(ToFrames()*1000*(FramesMax && (Flags.test(DropFrame) || Flags.test(FramesPerSecond_Is1001))?1.001:1.000)+Den/2)/Den;
+    //Exact rational computation, frame duration is 1000 or 1001 ms divided by the count of frames (or fields) per second
+    int64_t TC=ToFrames();
+    uint64_t Abs=TC<0?-TC:TC;
+    uint64_t Den=((((uint64_t)FramesMax)+1)*(Flags.test(MustUseSecondField)?2:1));
+    uint64_t Num=(FramesMax && (Flags.test(DropFrame) || Flags.test(FramesPerSecond_Is1001)))?1001:1000;
+    int64_t MS=(Abs/Den)*Num+((Abs%Den)*Num+Den/2)/Den;
 
     if (Flags.test(IsNegative))
         MS=-MS;
 
     return MS;
 }
+
+//***************************************************************************
+// TimeCode32
+//***************************************************************************
+
+//---------------------------------------------------------------------------
+bool TimeCode32::FromTimeCode(const TimeCode& tc)
+{
+    if (!tc.HasValue()
+     || tc.Frames>0xFF || tc.Seconds>0x3F || tc.Minutes>0x3F || tc.Hours>0x1F
+     || tc.Flags.test(TimeCode::IsNegative) || tc.Flags.test(TimeCode::IsTime) || tc.Flags.test(TimeCode::HasNoFramesInfo))
+    {
+        Value=NoValue;
+        return true;
+    }
+
+    *this=TimeCode32(tc.Hours, tc.Minutes, tc.Seconds, tc.Frames, tc.Flags.test(TimeCode::DropFrame), tc.Flags.test(TimeCode::MustUseSecondField), tc.Flags.test(TimeCode::IsSecondField), tc.Flags.test(TimeCode::FramesPerSecond_Is1001));
+    return false;
+}
+
+//---------------------------------------------------------------------------
+TimeCode TimeCode32::ToTimeCode(uint32_t FramesMax) const
+{
+    if (!HasValue())
+        return TimeCode();
+
+    TimeCode tc(GetHours(), GetMinutes(), GetSeconds(), GetFrames(), FramesMax, GetDropFrame(), GetMustUseSecondField(), GetIsSecondField());
+    tc.Set1001(Get1001());
+    return tc;
+}
+
+//***************************************************************************
+// TimeCodeRate
+//***************************************************************************
+
+//---------------------------------------------------------------------------
+TimeCodeRate::TimeCodeRate (uint32_t FramesMax_, bool DropFrame_)
+:   FramesMax(FramesMax_),
+    DropFrame(DropFrame_),
+    IsDivisionFree(FramesMax_<100000)
+{
+    FrameRate=FramesMax+1;
+    uint32_t Dropped=DropFrame?(1+FramesMax/30):0;
+    Dropped2=Dropped*2;
+    Dropped18=Dropped*18;
+    TenMinutesFrameCount=600*FrameRate-Dropped18;
+    MinuteFrameCount=60*FrameRate-Dropped2;
+
+    //ToFrames does not drop frames if FramesMax is 0
+    int64_t ToFrames_Dropped=FramesMax?Dropped:0;
+    HourFrameCount=3600*(int64_t)FrameRate-108*ToFrames_Dropped;
+    DayFrameCount=24*HourFrameCount;
+    for (uint32_t i=0; i<60; i++)
+        MinuteFrames[i]=(uint32_t)(i*60*(int64_t)FrameRate-(i/10)*18*ToFrames_Dropped-(i%10)*2*ToFrames_Dropped);
+
+    FrameRate_Divider.Set(IsDivisionFree?FrameRate:1);
+    TenMinutes_Divider.Set(IsDivisionFree?TenMinutesFrameCount:1);
+    Minute_Divider.Set(IsDivisionFree?MinuteFrameCount:1);
+    Milliseconds_Divider[0].Set(IsDivisionFree?FrameRate:1);
+    Milliseconds_Divider[1].Set(IsDivisionFree?FrameRate*2:1);
+}
+
+//---------------------------------------------------------------------------
+void TimeCodeRate::divider::Set(uint32_t Value)
+{
+    uint8_t Log2=0;
+    while (Log2<32 && ((uint64_t)1<<Log2)<Value)
+        Log2++;
+    Divisor=Value;
+    Shift=31+Log2;
+    Multiplier=(((uint64_t)1<<Shift)+Value-1)/Value;
+}
+
+//---------------------------------------------------------------------------
+bool TimeCodeRate::FromFrames(TimeCode& tc, int64_t Value) const
+{
+    tc.FramesMax=FramesMax;
+    tc.Flags.set(TimeCode::DropFrame, DropFrame);
+    if (!IsDivisionFree)
+        return tc.FromFrames(Value);
+
+    if (Value<0)
+    {
+        tc.Flags.set(TimeCode::IsNegative);
+        Value=-Value;
+    }
+    else
+        tc.Flags.reset(TimeCode::IsNegative);
+
+    uint64_t Frames_=Value;
+    uint64_t Seconds_;
+    uint64_t Frames_Remain;
+    if (Dropped2)
+    {
+        uint64_t Minutes_Tens=TenMinutes_Divider.Divide(Frames_); //Count of 10 minutes
+        uint64_t Minutes_Units=Minute_Divider.Divide(Frames_-Minutes_Tens*TenMinutesFrameCount);
+
+        Frames_+=Dropped18*Minutes_Tens+Dropped2*Minutes_Units;
+        Seconds_=FrameRate_Divider.Divide(Frames_);
+        Frames_Remain=Frames_-Seconds_*FrameRate;
+        if (Minutes_Units && Seconds_%60==0 && Frames_Remain<Dropped2) // Same as in TimeCode::FromFrames
+        {
+            Frames_-=Dropped2;
+            Seconds_=FrameRate_Divider.Divide(Frames_);
+            Frames_Remain=Frames_-Seconds_*FrameRate;
+        }
+    }
+    else
+    {
+        Seconds_=FrameRate_Divider.Divide(Frames_);
+        Frames_Remain=Frames_-Seconds_*FrameRate;
+    }
+
+    uint64_t HoursTemp=Seconds_/3600;
+    if (HoursTemp>(uint32_t)-1)
+    {
+        tc.Hours=(uint32_t)-1;
+        tc.Minutes=59;
+        tc.Seconds=59;
+        tc.Frames=FramesMax;
+        return true;
+    }
+    tc.Hours=(uint8_t)HoursTemp;
+    tc.Minutes=(Seconds_/60)%60;
+    tc.Seconds=Seconds_%60;
+    tc.Frames=(uint32_t)Frames_Remain;
+    tc.Flags.reset(TimeCode::IsTime);
+    tc.Flags.set(TimeCode::IsValid);
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+int64_t TimeCodeRate::ToFrames(const TimeCode& tc) const
+{
+    if (!IsDivisionFree || tc.Minutes>=60)
+        return tc.ToFrames();
+    if (!tc.HasValue())
+        return 0;
+
+    int64_t TC=tc.Hours*HourFrameCount
+             + MinuteFrames[tc.Minutes]
+             + tc.Seconds*(int64_t)FrameRate;
+
+    if (!tc.Flags.test(TimeCode::HasNoFramesInfo) && FramesMax)
+        TC+=tc.Frames;
+    if (tc.Flags.test(TimeCode::MustUseSecondField))
+        TC<<=1;
+    if (tc.Flags.test(TimeCode::IsSecondField))
+        TC++;
+    if (tc.Flags.test(TimeCode::IsNegative))
+        TC=-TC;
+
+    return TC;
+}
+
+//---------------------------------------------------------------------------
+int64_t TimeCodeRate::ToMilliseconds(const TimeCode& tc) const
+{
+    if (!IsDivisionFree)
+        return tc.ToMilliseconds();
+    if (!tc.HasValue())
+        return 0;
+
+    //Same as TimeCode::ToMilliseconds
+    int64_t TC=ToFrames(tc);
+    uint64_t Abs=TC<0?-TC:TC;
+    bool IsField=tc.Flags.test(TimeCode::MustUseSecondField);
+    const divider& Divider=Milliseconds_Divider[IsField];
+    uint64_t Num=(FramesMax && (tc.Flags.test(TimeCode::DropFrame) || tc.Flags.test(TimeCode::FramesPerSecond_Is1001)))?1001:1000;
+    uint64_t Quotient=Divider.Divide(Abs);
+    int64_t MS=Quotient*Num+Divider.Divide((Abs-Quotient*Divider.Divisor)*Num+Divider.Divisor/2);
+
+    if (tc.Flags.test(TimeCode::IsNegative))
+        MS=-MS;
+
+    return MS;
+}
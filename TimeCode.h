@@ -276,8 +276,12 @@ public:
     bool FromString(const char* Value, size_t Length); // return false if all fine
     bool FromString(const char* Value) {return FromString(Value, strlen(Value));}
     bool FromString(const std::string& Value) {return FromString(Value.c_str(), Value.size());}
+    size_t FromStrings(const char* const* Values, const size_t* Lengths, size_t Count, TimeCode* Results) const; // Same as FromString on copies of this timecode, values which are not timecodes are set to TimeCode(), return the count of such values
     bool FromFrames(int64_t Value);
     std::string ToString() const;
+    static const size_t ToString_MaxSize=48;
+    size_t ToString(char* Value) const; // Value must have room for ToString_MaxSize chars, return the count of chars written (not null terminated)
+    size_t ToStrings(char* Values, size_t Count, size_t* Ends); // Same as Count times ToString then PlusOne, Values must have room for Count*ToString_MaxSize chars, Ends receives the end of each value in Values, return the count of chars written
     int64_t ToFrames() const;
     int64_t ToMilliseconds() const;
 
@@ -299,6 +303,8 @@ public:
     void Set1001(bool Value=true) { Flags.set(FramesPerSecond_Is1001, Value); }
     bool GetMustUseSecondField() const { return Flags.test(MustUseSecondField); }
     void SetMustUseSecondField(bool Value=true) { Flags.set(MustUseSecondField, Value); }
+    bool GetIsSecondField() const { return Flags.test(IsSecondField); }
+    void SetIsSecondField(bool Value=true) { Flags.set(IsSecondField, Value); }
     bool GetIsTime() const { return Flags.test(IsTime); }
     void SetIsTime(bool Value=true) { Flags.set(IsTime, Value); }
     bool GetIsValid() const { return Flags.test(IsValid); }
@@ -306,6 +312,9 @@ public:
     float GetFrameRate() { return (FramesMax+1)/((Flags.test(DropFrame) || Flags.test(FramesPerSecond_Is1001))?1.001f:1.000f);}
 
 private:
+    friend class TimeCode32;
+    friend class TimeCodeRate;
+    template<uint32_t, bool> friend class TimeCodeFixed;
     uint32_t Frames;
     uint32_t FramesMax;
     uint32_t Hours;
@@ -326,4 +335,248 @@ private:
     bitset8 Flags;
 };
 
+//***************************************************************************
+// Class TimeCode32
+//***************************************************************************
+
+// Timecode packed in 32 bits for large arrays, frame rate is not stored (FramesMax is the one of the track)
+// Fields are in SMPTE 12M order (frames in the low bits, then seconds, minutes, hours), binary coded instead of BCD
+// so frame numbers up to 255 fit: frames (bits 0-7), seconds (8-13), minutes (14-19), hours (20-24),
+// drop frame (25), must use second field (26), is second field (27), 1/1.001 frame rate (28), bits 29-31 are 0 except for NoValue
+class TimeCode32
+{
+public:
+    static const uint32_t NoValue=0xFFFFFFFF;
+
+    //constructor/Destructor
+    constexpr TimeCode32 () : Value(NoValue) {}
+    constexpr explicit TimeCode32 (uint32_t Packed) : Value(Packed) {}
+    constexpr TimeCode32 (uint32_t Hours, uint8_t Minutes, uint8_t Seconds, uint32_t Frames, bool DropFrame=false, bool MustUseSecondField=false, bool IsSecondField=false, bool Is1001=false)
+    :   Value( (Frames&0xFF)
+             | ((uint32_t)(Seconds&0x3F)<<8)
+             | ((uint32_t)(Minutes&0x3F)<<14)
+             | ((Hours&0x1F)<<20)
+             | ((uint32_t)DropFrame<<25)
+             | ((uint32_t)MustUseSecondField<<26)
+             | ((uint32_t)IsSecondField<<27)
+             | ((uint32_t)Is1001<<28)) {}
+
+    //Operators
+    constexpr bool operator== (const TimeCode32 &tc) const { return Value==tc.Value; }
+    constexpr bool operator!= (const TimeCode32 &tc) const { return Value!=tc.Value; }
+
+    //Helpers
+    bool FromTimeCode(const TimeCode& tc); // return false if all fine, values which do not fit (e.g. hours after 31, negative, time) are not converted
+    TimeCode ToTimeCode(uint32_t FramesMax) const;
+    constexpr uint32_t ToPacked() const { return Value; }
+
+    constexpr bool HasValue() const { return Value!=NoValue; }
+    constexpr uint32_t GetHours() const { return (Value>>20)&0x1F; }
+    constexpr uint8_t GetMinutes() const { return (Value>>14)&0x3F; }
+    constexpr uint8_t GetSeconds() const { return (Value>>8)&0x3F; }
+    constexpr uint32_t GetFrames() const { return Value&0xFF; }
+    constexpr bool GetDropFrame() const { return (Value>>25)&1; }
+    constexpr bool GetMustUseSecondField() const { return (Value>>26)&1; }
+    constexpr bool GetIsSecondField() const { return (Value>>27)&1; }
+    constexpr bool Get1001() const { return (Value>>28)&1; }
+
+private:
+    uint32_t Value;
+};
+
+
+//***************************************************************************
+// Class TimeCodeRate
+//***************************************************************************
+
+// Constants of a frame rate precomputed once for many conversions, e.g. random seeks in a track
+// Divisions by the frame rate dependent counts are replaced by a multiplication and a shift (frame numbers below 2^31)
+// Results are the same as the ones of the TimeCode methods, timecodes must have the FramesMax and drop frame of the rate
+class TimeCodeRate
+{
+public:
+    //constructor/Destructor
+    TimeCodeRate (uint32_t FramesMax=0, bool DropFrame=false);
+
+    //Helpers
+    bool FromFrames(TimeCode& tc, int64_t Value) const; // Same as tc.FromFrames(Value), tc gets the FramesMax and drop frame of the rate
+    int64_t ToFrames(const TimeCode& tc) const;
+    int64_t ToMilliseconds(const TimeCode& tc) const;
+    int64_t GetDayFrameCount() const { return DayFrameCount; } // Frame count of 24 hours
+
+    uint32_t GetFramesMax() const { return FramesMax; }
+    bool GetDropFrame() const { return DropFrame; }
+
+private:
+    // Quotient of a division by a constant, with a multiplication and a shift if the dividend is below 2^31
+    // Multiplier is 2^Shift/Divisor rounded up, with Shift=31+ceil(log2(Divisor)) the quotient is exact
+    struct divider
+    {
+        uint64_t Multiplier;
+        uint32_t Divisor;
+        uint8_t Shift;
+
+        void Set(uint32_t Value);
+        uint64_t Divide(uint64_t Value) const { return Value<((uint64_t)1<<31)?(Value*Multiplier)>>Shift:Value/Divisor; }
+    };
+
+    uint32_t FramesMax;
+    bool DropFrame;
+    bool IsDivisionFree; // Else (very high frame rates) the TimeCode methods are used
+    uint32_t FrameRate;
+    uint32_t Dropped2; // Frames dropped per minute
+    uint32_t Dropped18; // Frames dropped per 10 minutes
+    uint32_t TenMinutesFrameCount;
+    uint32_t MinuteFrameCount;
+    int64_t HourFrameCount;
+    int64_t DayFrameCount;
+    uint32_t MinuteFrames[60]; // Frames from the start of the hour to the start of each minute, as counted by ToFrames
+    divider FrameRate_Divider;
+    divider TenMinutes_Divider;
+    divider Minute_Divider;
+    divider Milliseconds_Divider[2]; // Frame rate, field rate
+};
+
+
+//***************************************************************************
+// Class TimeCodeFixed
+//***************************************************************************
+
+// Timecode with the frame rate as template parameters, so increments and formatting are computed with constants
+// Only the values of a track with the frame rate, without fields, sign or time and with hours before 24 are supported
+// ToString provides the same text as TimeCode::ToString
+template<uint32_t FramesMax_, bool DropFrame_>
+class TimeCodeFixed
+{
+public:
+    static_assert(FramesMax_<1000, "frame numbers are formatted with up to 3 digits");
+    static const uint32_t FramesMax=FramesMax_;
+    static const bool DropFrame=DropFrame_;
+    static const uint32_t Dropped2=DropFrame?(1+FramesMax/30)*2:0; // Frames dropped per minute
+    static const size_t ToString_MaxSize=12;
+
+    //constructor/Destructor
+    constexpr TimeCodeFixed (uint8_t Hours_=0, uint8_t Minutes_=0, uint8_t Seconds_=0, uint32_t Frames_=0)
+    :   Frames(Frames_), Hours(Hours_), Minutes(Minutes_), Seconds(Seconds_) {}
+
+    //Operators
+    TimeCodeFixed& operator ++() { PlusOne(); return *this; }
+    constexpr bool operator== (const TimeCodeFixed &tc) const { return Hours==tc.Hours && Minutes==tc.Minutes && Seconds==tc.Seconds && Frames==tc.Frames; }
+    constexpr bool operator!= (const TimeCodeFixed &tc) const { return !(*this==tc); }
+
+    //Helpers
+    bool FromTimeCode(const TimeCode& tc) // return false if all fine, values which are not supported are not converted
+    {
+        if (!tc.HasValue()
+         || tc.FramesMax!=FramesMax || tc.Flags.test(TimeCode::DropFrame)!=DropFrame
+         || tc.Flags.test(TimeCode::MustUseSecondField) || tc.Flags.test(TimeCode::IsSecondField) || tc.Flags.test(TimeCode::IsNegative)
+         || tc.Flags.test(TimeCode::HasNoFramesInfo) || tc.Flags.test(TimeCode::IsTime)
+         || tc.Hours>=24 || tc.Minutes>=60 || tc.Seconds>=60 || tc.Frames>FramesMax)
+            return true;
+        Hours=(uint8_t)tc.Hours;
+        Minutes=tc.Minutes;
+        Seconds=tc.Seconds;
+        Frames=tc.Frames;
+        return false;
+    }
+    TimeCode ToTimeCode() const { return TimeCode(Hours, Minutes, Seconds, Frames, FramesMax, DropFrame); }
+    void ToTimeCode(TimeCode& tc) const // Only hours, minutes, seconds and frames are set, e.g. for updating the timecode this one is converted from
+    {
+        tc.Hours=Hours;
+        tc.Minutes=Minutes;
+        tc.Seconds=Seconds;
+        tc.Frames=Frames;
+    }
+
+    void PlusOne()
+    {
+        if (++Frames<=FramesMax)
+            return;
+        Frames=0;
+        if (++Seconds<60)
+            return;
+        Seconds=0;
+        Minutes++;
+        if (DropFrame && Minutes%10)
+            Frames=Dropped2; //frames 0 and 1 (at 30 fps) are dropped for every minutes except 00 10 20 30 40 50
+        if (Minutes<60)
+            return;
+        Minutes=0;
+        if (++Hours>=24)
+            Hours=0;
+    }
+    size_t ToString(char* Value) const // Value must have room for ToString_MaxSize chars, return the count of chars written (not null terminated)
+    {
+        Value[0]='0'+Hours/10;
+        Value[1]='0'+Hours%10;
+        Value[2]=':';
+        Value[3]='0'+Minutes/10;
+        Value[4]='0'+Minutes%10;
+        Value[5]=':';
+        Value[6]='0'+Seconds/10;
+        Value[7]='0'+Seconds%10;
+        Value[8]=DropFrame?';':':';
+        uint32_t FF=Frames;
+        size_t Size=9;
+        if (FramesMax>=100 && FF>=100)
+        {
+            Value[Size++]='0'+FF/100;
+            FF%=100;
+        }
+        Value[Size++]='0'+FF/10;
+        Value[Size++]='0'+FF%10;
+        return Size;
+    }
+    size_t ToStrings(char* Values, size_t Count, size_t* Ends) // Same as TimeCode::ToStrings
+    {
+        size_t Size=0;
+        size_t i=0;
+        while (i<Count)
+        {
+            char Prefix[ToString_MaxSize];
+            ToString(Prefix); // Only the frame number changes within a second, "hh:mm:ss:" is kept
+            uint32_t Last=FramesMax;
+            if (Count-i<=Last-Frames)
+                Last=Frames+(uint32_t)(Count-i)-1;
+            for (uint32_t FF=Frames; FF<=Last; FF++)
+            {
+                char* TC=Values+Size;
+                memcpy(TC, Prefix, 9);
+                TC+=9;
+                uint32_t FF2=FF;
+                if (FramesMax>=100 && FF2>=100)
+                {
+                    *TC++='0'+FF2/100;
+                    FF2%=100;
+                }
+                TC[0]='0'+FF2/10;
+                TC[1]='0'+FF2%10;
+                Size=TC+2-Values;
+                Ends[i++]=Size;
+            }
+            Frames=Last;
+            PlusOne();
+        }
+        return Size;
+    }
+    int64_t ToFrames() const
+    {
+        const int64_t Dropped=(DropFrame && FramesMax)?(1+FramesMax/30):0;
+        return (int64_t(Hours)*3600+Minutes*60+Seconds)*(FramesMax+1)
+             - int64_t(Hours)*108*Dropped - (Minutes/10)*18*Dropped - (Minutes%10)*2*Dropped
+             + (FramesMax?Frames:0);
+    }
+
+    constexpr uint32_t GetHours() const { return Hours; }
+    constexpr uint8_t GetMinutes() const { return Minutes; }
+    constexpr uint8_t GetSeconds() const { return Seconds; }
+    constexpr uint32_t GetFrames() const { return Frames; }
+
+private:
+    uint32_t Frames;
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+};
+
 #endif
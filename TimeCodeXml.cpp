@@ -0,0 +1,2360 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "TimeCodeXml.h"
+#include "tfsxml.h"
+#include "CueTime.h"
+#include "TimeCode.h"
+#include <algorithm>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace timecodexml {
+
+// Internal types and helpers, not visible outside of the library
+namespace {
+
+struct stream_struct
+{
+    tfsxml_string   xml_handle{};
+    tfsxml_string   n{};
+    bool            xml_handle_is_used = false;
+    string          id;
+    TimeCode        timecode;
+    long long       frame_count = 0;
+
+    // Values following a tc element with frame_count, the same value is repeated if it is not a timecode
+    TimeCode        run_timecode;
+    long long       run_count = 0;
+    bool            run_is_timecode = true;
+    string          run_value;
+    tfsxml_string   run_raw{};
+    bool            has_invalid_frame_count = false; // A tc element has a frame_count which is not a count of frames, the stream ends at this element
+
+    // Position on the common time line
+    uint64_t        frame_rate_num = 0;
+    uint64_t        frame_rate_den = 0;
+    uint64_t        frame_duration = 0;
+    uint64_t        next_time = 0;
+    bool            is_started = false;
+    bool            is_finished = false;
+
+    // Values of the frames of the current block, computed by a worker
+    string          block_values;
+    vector<size_t>  block_ends;
+    vector<char>    block_is_expected;  // Value is the previous value plus 1 frame
+    vector<const char*> block_value_data; // Values of the current block as parsed in bulk
+    vector<size_t>  block_value_sizes;
+    vector<TimeCode> block_timecodes;
+    size_t          block_frame_count = 0;
+    size_t          block_pos = 0;
+
+    // Cues
+    const char*     value = "";
+    size_t          value_size = 0;
+    string          value_copy;         // Value of the current frame when the block is replaced
+    string          next_value;         // Expected value for the next frame
+    string          cue_value;
+
+    // Cue visitor
+    TimeCode        visit_timecode;     // Value of the current frame if computed
+    TimeCode        visit_next_timecode;// Expected value for the next frame
+    bool            visit_has_next = false;
+    string          visit_decoded;      // Raw value with decoded character references
+};
+
+// Threads running the tasks of a job, the calling thread runs tasks too
+struct worker_pool
+{
+    vector<thread>  workers;
+    mutex           job_mutex;
+    condition_variable job_start;
+    condition_variable job_end;
+    const function<void(size_t)>* job = nullptr;
+    size_t          job_count = 0;
+    size_t          job_next = 0;
+    size_t          job_pending = 0;
+    bool            is_stopping = false;
+
+    explicit worker_pool(size_t thread_count)
+    {
+        for (size_t i = 1; i < thread_count; i++) {
+            workers.emplace_back([this]() {
+                unique_lock<mutex> lock(job_mutex);
+                for (;;) {
+                    job_start.wait(lock, [this]() { return is_stopping || job_next < job_count; });
+                    if (is_stopping) {
+                        return;
+                    }
+                    RunTask(lock);
+                }
+            });
+        }
+    }
+
+    ~worker_pool()
+    {
+        {
+            lock_guard<mutex> lock(job_mutex);
+            is_stopping = true;
+        }
+        job_start.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Calls task(0) to task(count - 1), returns when all calls are done
+    void Run(size_t count, const function<void(size_t)>& task)
+    {
+        if (workers.empty() || count < 2) {
+            for (size_t i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+        unique_lock<mutex> lock(job_mutex);
+        job = &task;
+        job_count = count;
+        job_next = 0;
+        job_pending = count;
+        job_start.notify_all();
+        while (job_next < job_count) {
+            RunTask(lock);
+        }
+        job_end.wait(lock, [this]() { return !job_pending; });
+        job = nullptr;
+        job_count = 0;
+    }
+
+    void RunTask(unique_lock<mutex>& lock)
+    {
+        auto i = job_next++;
+        auto task = job;
+        lock.unlock();
+        (*task)(i);
+        lock.lock();
+        if (!--job_pending) {
+            job_end.notify_all();
+        }
+    }
+};
+
+// Read-only view of the input file, memory mapped if possible else read in full
+// or, for standard input, read by blocks and parsed with the partial API of tfsxml
+struct input_struct
+{
+    const char*     buf = nullptr;
+    size_t          len = 0;
+    char*           copy = nullptr;
+    vector<char>    blocks;
+    bool            is_partial = false;
+    static const size_t block_size = 1 << 16;
+    #if defined(_WIN32)
+    HANDLE          file = INVALID_HANDLE_VALUE;
+    HANDLE          mapping = NULL;
+    const void*     view = nullptr;     // Mapped view of the file, buf may also be a buffer of the caller or a copy
+    #else
+    void*           mapping = MAP_FAILED;
+    #endif
+
+    ~input_struct()
+    {
+        #if defined(_WIN32)
+        if (view) {
+            UnmapViewOfFile(view);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        #else
+        if (mapping != MAP_FAILED) {
+            munmap(mapping, len);
+        }
+        #endif
+        delete[] copy;
+    }
+
+    bool Map(const char* file_name)
+    {
+        #if defined(_WIN32)
+        file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || (unsigned long long)size.QuadPart > numeric_limits<size_t>::max()) {
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            return false;
+        }
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            return false;
+        }
+        buf = (const char*)view;
+        len = (size_t)size.QuadPart;
+        #else
+        int fd = open(file_name, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 || (unsigned long long)st.st_size > numeric_limits<size_t>::max()) {
+            close(fd);
+            return false;
+        }
+        mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping stays valid after the file is closed
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        len = (size_t)st.st_size;
+        buf = (const char*)mapping;
+        #if defined(MADV_SEQUENTIAL)
+        madvise(mapping, len, MADV_SEQUENTIAL);
+        #endif
+        #endif
+        return true;
+    }
+
+    bool Read(const char* file_name)
+    {
+        ifstream input_file(file_name, ios_base::in | ios_base::ate | ios_base::binary);
+        auto input_size = input_file.tellg();
+        if (input_size <= 0 || (unsigned long long)input_size > numeric_limits<size_t>::max()) {
+            return false;
+        }
+        input_file.seekg(0);
+        copy = new char[(size_t)input_size];
+        if (input_file.read(copy, input_size).fail()) {
+            return false;
+        }
+        buf = copy;
+        len = (size_t)input_size;
+        return true;
+    }
+
+    int Init(tfsxml_string& xml_handle)
+    {
+        if (!is_partial) {
+            return tfsxml_init(&xml_handle, buf, (tfsxml_size)len);
+        }
+
+        #if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+        #endif
+        int result;
+        bool is_last = false;
+        do {
+            is_last = !ReadBlock();
+            result = tfsxml_init_partial(&xml_handle, buf, (tfsxml_size)len);
+        } while (result == TFSXML_NEED_MORE_DATA && !is_last);
+        if (result == TFSXML_NEED_MORE_DATA) {
+            return tfsxml_init(&xml_handle, buf, (tfsxml_size)len);
+        }
+        return result;
+    }
+
+    // Appends a block read from standard input, returns false if there is no more content
+    // The block is at least as big as the kept content, so a parser restarting an element from its beginning
+    // after each block does not scan the content a quadratic count of times
+    bool ReadBlock()
+    {
+        size_t size = block_size;
+        if (size < len) {
+            size = len;
+        }
+        if (blocks.size() < len + size) {
+            blocks.resize(max(blocks.size() * 2, len + size));
+        }
+        auto read = fread(blocks.data() + len, 1, size, stdin);
+        buf = blocks.data();
+        len += read;
+        return read;
+    }
+
+    // Discards the content already consumed by all parsers, then provides more content to the parsers
+    void Refill(tfsxml_string* xml_handle, vector<stream_struct>& streams)
+    {
+        const char* end = buf + len;
+        const char* keep = end;
+        if (xml_handle) {
+            keep = min(keep, end - tfsxml_remain(xml_handle));
+        }
+        for (const auto& stream : streams) {
+            if (stream.xml_handle_is_used) {
+                if (stream.n.buf) {
+                    keep = min(keep, stream.n.buf);
+                }
+                keep = min(keep, end - tfsxml_remain(&stream.xml_handle));
+            }
+        }
+        auto keep_pos = keep - buf;
+        len -= keep_pos;
+        memmove(blocks.data(), keep, len);
+        auto old_buf = buf + keep_pos;
+        bool is_last = !ReadBlock();
+
+        auto feed = [&](tfsxml_string& handle) {
+            auto handle_len = tfsxml_remain(&handle);
+            auto handle_buf = end - handle_len - old_buf + buf;
+            tfsxml_feed(&handle, handle_buf, buf + len - handle_buf, is_last);
+        };
+        if (xml_handle) {
+            feed(*xml_handle);
+        }
+        for (auto& stream : streams) {
+            if (stream.xml_handle_is_used) {
+                if (stream.n.buf) {
+                    stream.n.buf += buf - old_buf;
+                }
+                feed(stream.xml_handle);
+            }
+        }
+    }
+};
+
+// Greatest common divisor (GCD) for uint64_t
+uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t t = b;
+        b = a % b;
+        a = t;
+    }
+    return a;
+}
+
+bool ParseRational(const std::string& s, uint64_t& num, uint64_t& den) {
+    if (s.empty()) return false;
+
+    size_t pos = 0;
+    uint64_t n = 0;
+
+    // Parse integer part before '/' or '.'
+    try {
+        n = std::stoull(s, &pos);
+    }
+    catch (...) {
+        return false;
+    }
+
+    uint64_t d = 1;  // default denominator
+
+    // Fraction "a/b"
+    if (pos < s.size() && s[pos] == '/') {
+        try {
+            d = std::stoull(s.substr(pos + 1));
+        }
+        catch (...) {
+            return false;
+        }
+        if (d == 0) return false;
+    }
+    // Decimal "x.y"
+    else if (pos < s.size() && s[pos] == '.') {
+        uint64_t frac = 0;
+        uint64_t pow10 = 1;
+        for (size_t i = pos + 1; i < s.size(); ++i) {
+            char c = s[i];
+            if (c < '0' || c > '9') return false;
+            frac = frac * 10 + (c - '0');
+            pow10 *= 10;
+        }
+        n = n * pow10 + frac;
+        d = pow10;
+    }
+
+    // Reduce the fraction to lowest terms
+    uint64_t g = gcd(n, d);
+    num = n / g;
+    den = d / g;
+
+    return true;
+}
+
+// Rates of N*1000/1001 fps written as decimal numbers with 2 or 3 decimals (e.g. 23.98, 29.97, 47.952, 59.94, 119.88) are replaced by the exact fraction
+void Normalize1001(uint64_t& num, uint64_t& den)
+{
+    if (den <= 1 || den > 1000 || num / den >= 1000) {
+        return;
+    }
+    auto n = (num * 1001 + den * 500) / (den * 1000); // Rate * 1.001 rounded
+    auto diff = num * 1001 > n * 1000 * den ? num * 1001 - n * 1000 * den : n * 1000 * den - num * 1001;
+    if (n && diff * 200 < den * 1001) { // Less than 0.005 from N*1000/1001
+        num = n * 1000;
+        den = 1001;
+    }
+}
+
+// Timecode of a raw value, character references are decoded in decoded if any, return false if all fine
+bool RawToTimeCode(TimeCode& timecode, const tfsxml_string& raw, string& decoded)
+{
+    if (!raw.flags) {
+        return timecode.FromString(raw.buf, raw.len);
+    }
+    decoded.clear();
+    tfsxml_decode(decoded, raw);
+    return timecode.FromString(decoded);
+}
+
+// Timecode is the same as FromFrames(ToFrames()), rate is the one of the timecode
+bool IsComputable(const TimeCode& timecode, const TimeCodeRate& rate)
+{
+    TimeCode check = timecode;
+    return !timecode.GetMustUseSecondField() && !timecode.GetNegative() && timecode.GetHours() < 24 && !rate.FromFrames(check, rate.ToFrames(timecode)) && check == timecode;
+}
+
+// Count of increments making a timecode computable if it is a dropped frame number
+uint32_t ComputableTryCount(const TimeCode& timecode)
+{
+    return timecode.GetDropFrame() ? 2 * (1 + timecode.GetFramesMax() / 30) + 1 : 1;
+}
+
+// Value count frames later, same as count increments but computed directly if possible, rate is the one of the timecode
+// A dropped frame number is not computable directly but becomes valid after a few increments
+void AddFrames(TimeCode& timecode, long long count, const TimeCodeRate& rate)
+{
+    auto try_count = ComputableTryCount(timecode);
+    for (uint32_t i = 0; i < try_count && count > 0; i++) {
+        if (IsComputable(timecode, rate)) {
+            // Timecodes wrap after 24 hours
+            auto day_frame_count = rate.GetDayFrameCount();
+            rate.FromFrames(timecode, (rate.ToFrames(timecode) + count % day_frame_count) % day_frame_count);
+            return;
+        }
+        timecode++;
+        count--;
+    }
+    while (count-- > 0) {
+        timecode++;
+    }
+}
+
+void AddFrames(TimeCode& timecode, long long count)
+{
+    AddFrames(timecode, count, TimeCodeRate(timecode.GetFramesMax(), timecode.GetDropFrame()));
+}
+
+// Values of the next count frames, each value is appended to values and its end to ends
+// Values are formatted in bulk by chunks
+template<typename T>
+void AppendTimeCodes(T& timecode, size_t count, string& values, vector<size_t>& ends)
+{
+    const size_t chunk_size = 256;
+    char chunk_values[chunk_size * T::ToString_MaxSize];
+    size_t chunk_ends[chunk_size];
+    while (count) {
+        auto chunk_count = min(count, chunk_size);
+        auto base = values.size();
+        values.append(chunk_values, timecode.ToStrings(chunk_values, chunk_count, chunk_ends));
+        for (size_t i = 0; i < chunk_count; i++) {
+            ends.push_back(base + chunk_ends[i]);
+        }
+        count -= chunk_count;
+    }
+}
+
+// Same with the frame rate known at compile time, returns false if the timecode is not supported
+template<uint32_t frames_max, bool drop_frame>
+bool AppendTimeCodesFixed(TimeCode& timecode, size_t count, string& values, vector<size_t>& ends)
+{
+    TimeCodeFixed<frames_max, drop_frame> fixed;
+    if (fixed.FromTimeCode(timecode)) {
+        return false;
+    }
+    AppendTimeCodes(fixed, count, values, ends);
+    fixed.ToTimeCode(timecode);
+    return true;
+}
+
+// Same as AppendTimeCodes, with a specialized loop for the common frame rates
+void AppendTimeCodesDispatch(TimeCode& timecode, size_t count, string& values, vector<size_t>& ends)
+{
+    bool is_done;
+    bool drop_frame = timecode.GetDropFrame();
+    switch (timecode.GetFramesMax()) {
+        case 23: is_done = !drop_frame && AppendTimeCodesFixed<23, false>(timecode, count, values, ends); break;
+        case 24: is_done = !drop_frame && AppendTimeCodesFixed<24, false>(timecode, count, values, ends); break;
+        case 29: is_done = drop_frame ? AppendTimeCodesFixed<29, true>(timecode, count, values, ends) : AppendTimeCodesFixed<29, false>(timecode, count, values, ends); break;
+        case 49: is_done = !drop_frame && AppendTimeCodesFixed<49, false>(timecode, count, values, ends); break;
+        case 59: is_done = drop_frame ? AppendTimeCodesFixed<59, true>(timecode, count, values, ends) : AppendTimeCodesFixed<59, false>(timecode, count, values, ends); break;
+        default: is_done = false;
+    }
+    if (!is_done) {
+        AppendTimeCodes(timecode, count, values, ends);
+    }
+}
+
+// Timecode at the first frame of an index segment
+TimeCode IndexTimeCode(const timecode_index_segment& segment)
+{
+    TimeCode timecode(segment.hours, segment.minutes, segment.seconds, segment.frames, segment.frames_max, segment.flags & timecode_index_drop_frame, segment.flags & timecode_index_must_use_second_field, segment.flags & timecode_index_is_second_field);
+    timecode.Set1001(segment.flags & timecode_index_1001);
+    timecode.SetNegative(segment.flags & timecode_index_negative);
+    timecode.SetIsTime(segment.flags & timecode_index_is_time);
+    return timecode;
+}
+
+// Output is sent by blocks of this size, so memory usage does not depend on the count of cues
+const size_t output_block_size = 1 << 16;
+
+void FlushOutput(output_sink& out, string& output, bool force = false)
+{
+    if (output.size() < output_block_size && !force) {
+        return;
+    }
+    out.Write(output.data(), output.size());
+    output.clear(); // Capacity is kept, the buffer is reused for next cues
+}
+
+// Count of frames of a frame_count attribute, -1 if it is not an integer from 0 to 2^62 - 1
+// The attribute is decoded only if it has references, so tc elements of the visitor are not copied
+long long ParseFrameCount(const tfsxml_string& value)
+{
+    string decoded;
+    const char* buf = value.buf;
+    size_t len = value.len;
+    if (memchr(buf, '&', len)) {
+        decoded = tfsxml_decode(value);
+        buf = decoded.data();
+        len = decoded.size();
+    }
+    size_t i = 0;
+    while (i < len && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\r' || buf[i] == '\n')) {
+        i++;
+    }
+    if (i < len && buf[i] == '+') {
+        i++;
+    }
+    if (i == len || buf[i] < '0' || buf[i] > '9') {
+        return -1;
+    }
+    long long result = 0;
+    for (; i < len && buf[i] >= '0' && buf[i] <= '9'; i++) {
+        result = result * 10 + (buf[i] - '0');
+        if (result >= ((long long)1 << 62)) {
+            return -1;
+        }
+    }
+    while (i < len && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\r' || buf[i] == '\n')) {
+        i++;
+    }
+    return i == len ? result : -1;
+}
+
+// Receives the output in a string
+struct string_sink : output_sink
+{
+    string          out;
+
+    void Write(const char* data, size_t size) override { out.append(data, size); }
+};
+
+// Binary MediaTimecode: magic, version, 3 reserved bytes, then 1 token per element until binary_end
+// Names are a varint, index in binary_names plus 1, or 0 followed by the name as a string
+// Strings are a varint length then the decoded value, varints are little-endian base 128
+const char binary_magic[4] = { 'M', 'T', 'C', 'B' };
+const uint8_t binary_version = 1;
+const size_t binary_header_size = 8;
+
+enum binary_token
+{
+    binary_end,
+    binary_element,                 // Name, attributes, then the sub-elements until binary_element_end
+    binary_element_end,
+    binary_empty_element,           // Name, attributes
+    binary_text_element,            // Name, attributes, text
+    binary_tc_run,                  // TimeCode32 (4 bytes), count of tc elements with only a v attribute, incrementing by 1 per frame
+    binary_markup,                  // Comment or other markup, as is without the angle brackets
+};
+
+const char* const binary_names[] =
+{
+    "MediaTimecode",
+    "creatingApplication",
+    "creatingLibrary",
+    "media",
+    "timecode_stream",
+    "tc",
+    "xmlns",
+    "version",
+    "url",
+    "build_date",
+    "build_time",
+    "compiler_ident",
+    "ref",
+    "format",
+    "full",
+    "id",
+    "source",
+    "frame_rate",
+    "frame_count",
+    "start_tc",
+    "fp",
+    "bgf",
+    "bg",
+    "v",
+    "nc",
+};
+const size_t binary_names_size = sizeof(binary_names) / sizeof(binary_names[0]);
+
+// Same frames max as the one used for the timecodes of a track by Convert
+uint32_t FramesMaxOf(const string& frame_rate)
+{
+    uint64_t num, den;
+    if (!ParseRational(frame_rate, num, den) || !den) {
+        return 0;
+    }
+    auto frames_max = num / den - (num % den == 0);
+    return frames_max > numeric_limits<uint32_t>::max() ? 0 : (uint32_t)frames_max;
+}
+
+void WriteVarint(string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+void WriteString(string& out, const char* data, size_t size)
+{
+    WriteVarint(out, size);
+    out.append(data, size);
+}
+
+bool ReadVarint(const char*& p, const char* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        auto byte = (uint8_t)*p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadString(const char*& p, const char* end, const char*& data, size_t& size)
+{
+    uint64_t value;
+    if (!ReadVarint(p, end, value) || value > (uint64_t)(end - p)) {
+        return false;
+    }
+    data = p;
+    size = (size_t)value;
+    p += size;
+    return true;
+}
+
+// Converts XML elements to binary tokens, tc elements incrementing by 1 per frame are grouped in runs
+struct binary_writer
+{
+    string&         out;
+    string          decoded;
+    string          text;
+
+    // Current run of tc elements
+    uint32_t        frames_max = 0;
+    TimeCode32      run_start;
+    uint64_t        run_count = 0;
+    TimeCode        run_next;
+    char            run_next_text[TimeCode::ToString_MaxSize];
+    size_t          run_next_size = 0;
+
+    explicit binary_writer(string& out_) : out(out_) {}
+
+    void WriteName(const tfsxml_string& name)
+    {
+        for (size_t i = 0; i < binary_names_size; i++) {
+            if (!tfsxml_strcmp_charp(name, binary_names[i])) {
+                WriteVarint(out, i + 1);
+                return;
+            }
+        }
+        WriteVarint(out, 0);
+        decoded.clear();
+        tfsxml_decode(decoded, name);
+        WriteString(out, decoded.data(), decoded.size());
+    }
+
+    void FlushRun()
+    {
+        if (!run_count) {
+            return;
+        }
+        out += (char)binary_tc_run;
+        for (int i = 0; i < 32; i += 8) {
+            out += (char)(run_start.ToPacked() >> i);
+        }
+        WriteVarint(out, run_count);
+        run_count = 0;
+    }
+
+    // Returns true if the tc element is in a run, value is kept only if the same text is rebuilt from the packed timecode
+    bool AddToRun(const tfsxml_string& value)
+    {
+        text.clear();
+        tfsxml_decode(text, value);
+        if (run_count && text.size() == run_next_size && !memcmp(text.data(), run_next_text, run_next_size)) {
+            run_count++;
+        }
+        else {
+            FlushRun();
+            TimeCode timecode;
+            timecode.SetFramesMax(frames_max);
+            TimeCode32 packed;
+            if (timecode.FromString(text) || packed.FromTimeCode(timecode)) {
+                return false;
+            }
+            run_next = packed.ToTimeCode(frames_max);
+            run_next_size = run_next.ToString(run_next_text);
+            if (text.size() != run_next_size || memcmp(text.data(), run_next_text, run_next_size)) {
+                return false;
+            }
+            run_start = packed;
+            run_count = 1;
+        }
+        run_next++;
+        run_next_size = run_next.ToString(run_next_text);
+        return true;
+    }
+
+    int WriteElements(tfsxml_string& handle, bool is_stream)
+    {
+        tfsxml_string n, attr_name, attr_value, value;
+        vector<pair<tfsxml_string, tfsxml_string>> attrs;
+        while (!tfsxml_next(&handle, &n)) {
+            if (n.len && (n.buf[0] == '?' || n.buf[0] == '!')) {
+                // Comments are kept as they count as frames without value in a track, the XML declaration is written again
+                if (n.len < 5 || memcmp(n.buf, "?xml", 4) || (n.buf[4] != ' ' && n.buf[4] != '?')) {
+                    FlushRun();
+                    out += (char)binary_markup;
+                    WriteString(out, n.buf, n.len);
+                }
+                continue;
+            }
+            attrs.clear();
+            while (!tfsxml_attr(&handle, &attr_name, &attr_value)) {
+                attrs.emplace_back(attr_name, attr_value);
+            }
+            // Content is checked on a copy of the parser state, value is available only if there is no sub-element
+            auto probe = handle;
+            bool has_text = false;
+            if (!tfsxml_value(&probe, &value)) {
+                for (tfsxml_size i = 0; i < value.len && !has_text; i++) {
+                    has_text = value.buf[i] != ' ' && value.buf[i] != '\t' && value.buf[i] != '\r' && value.buf[i] != '\n';
+                }
+            }
+            bool has_sub_elements = false;
+            if (!has_text) {
+                probe = handle;
+                has_sub_elements = !tfsxml_enter(&probe) && !tfsxml_next(&probe, &value);
+            }
+            if (is_stream && !has_sub_elements && !has_text && attrs.size() == 1 && !tfsxml_strcmp_charp(n, "tc") && !tfsxml_strcmp_charp(attrs[0].first, "v") && AddToRun(attrs[0].second)) {
+                continue;
+            }
+            FlushRun();
+
+            bool is_timecode_stream = !tfsxml_strcmp_charp(n, "timecode_stream");
+            if (is_timecode_stream) {
+                frames_max = 0;
+            }
+            out += (char)(has_sub_elements ? binary_element : has_text ? binary_text_element : binary_empty_element);
+            WriteName(n);
+            WriteVarint(out, attrs.size());
+            for (const auto& attr : attrs) {
+                WriteName(attr.first);
+                decoded.clear();
+                tfsxml_decode(decoded, attr.second);
+                WriteString(out, decoded.data(), decoded.size());
+                if (is_timecode_stream && !tfsxml_strcmp_charp(attr.first, "frame_rate")) {
+                    frames_max = FramesMaxOf(decoded);
+                }
+            }
+            if (has_sub_elements) {
+                if (tfsxml_enter(&handle) || WriteElements(handle, is_timecode_stream)) {
+                    return 1;
+                }
+                FlushRun();
+                out += (char)binary_element_end;
+            }
+            else if (has_text) {
+                tfsxml_value(&handle, &value);
+                decoded.clear();
+                tfsxml_decode(decoded, value);
+                WriteString(out, decoded.data(), decoded.size());
+            }
+        }
+        return 0;
+    }
+};
+
+int WriteBinary(input_struct& input, string& binary, ostream& err)
+{
+    if (input.len > (size_t)numeric_limits<tfsxml_size>::max()) {
+        err << "Error: input file too big\n";
+        return 1;
+    }
+    tfsxml_string handle;
+    if (tfsxml_init(&handle, input.buf, (tfsxml_size)input.len)) {
+        err << "Error: issue when parsing the XML input file\n";
+        return 1;
+    }
+    binary.assign(binary_magic, sizeof(binary_magic));
+    binary += (char)binary_version;
+    binary.append(binary_header_size - binary.size(), '\0');
+    binary_writer writer(binary);
+    if (writer.WriteElements(handle, false)) {
+        err << "Error: issue when parsing the XML input file\n";
+        return 1;
+    }
+    binary += (char)binary_end;
+    return 0;
+}
+
+void AppendEscaped(string& output, const char* data, size_t size, bool is_attribute)
+{
+    for (size_t i = 0; i < size; i++) {
+        switch (data[i]) {
+        case '&': output += "&amp;"; break;
+        case '<': output += "&lt;"; break;
+        case '>': output += "&gt;"; break;
+        case '"':
+            if (is_attribute) {
+                output += "&quot;";
+                break;
+            }
+            // Fall through
+        default: output += data[i];
+        }
+    }
+}
+
+// Converts binary tokens to XML elements, with compact runs are 1 tc element with frame_count instead of 1 tc element per frame
+int ReadBinary(const char* buf, size_t len, output_sink& out, bool is_compact, ostream& err)
+{
+    if (!IsBinary(buf, len)) {
+        err << "Error: not a binary MediaTimecode file\n";
+        return 1;
+    }
+    if ((uint8_t)buf[sizeof(binary_magic)] != binary_version) {
+        err << "Error: binary MediaTimecode version is not supported\n";
+        return 1;
+    }
+    auto p = buf + binary_header_size;
+    auto end = buf + len;
+    auto corrupted = [&]() {
+        err << "Error: binary MediaTimecode file is truncated or corrupted\n";
+        return 1;
+    };
+
+    string output;
+    output.reserve(output_block_size + 0x1000);
+    output += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    vector<string> names;
+    string name;
+    uint32_t frames_max = 0;
+    char timecode_text[TimeCode::ToString_MaxSize];
+    for (;;) {
+        if (p == end) {
+            return corrupted();
+        }
+        auto token = (uint8_t)*p++;
+        switch (token) {
+        case binary_end:
+            if (!names.empty() || p != end) {
+                return corrupted();
+            }
+            FlushOutput(out, output, true);
+            return 0;
+        case binary_element:
+        case binary_empty_element:
+        case binary_text_element: {
+            auto read_name = [&](string& value) {
+                uint64_t index;
+                if (!ReadVarint(p, end, index) || index > binary_names_size) {
+                    return false;
+                }
+                if (index) {
+                    value = binary_names[index - 1];
+                    return true;
+                }
+                const char* data;
+                size_t size;
+                if (!ReadString(p, end, data, size)) {
+                    return false;
+                }
+                value.assign(data, size);
+                return true;
+            };
+            uint64_t attr_count;
+            if (!read_name(name) || !ReadVarint(p, end, attr_count)) {
+                return corrupted();
+            }
+            bool is_timecode_stream = name == "timecode_stream";
+            if (is_timecode_stream) {
+                frames_max = 0;
+            }
+            output += '<';
+            output += name;
+            string attr_name;
+            for (uint64_t i = 0; i < attr_count; i++) {
+                const char* data;
+                size_t size;
+                if (!read_name(attr_name) || !ReadString(p, end, data, size)) {
+                    return corrupted();
+                }
+                output += ' ';
+                output += attr_name;
+                output += "=\"";
+                AppendEscaped(output, data, size, true);
+                output += '"';
+                if (is_timecode_stream && attr_name == "frame_rate") {
+                    frames_max = FramesMaxOf(string(data, size));
+                }
+            }
+            if (token == binary_element) {
+                output += ">\n";
+                names.push_back(name);
+            }
+            else if (token == binary_empty_element) {
+                output += "/>\n";
+            }
+            else {
+                const char* data;
+                size_t size;
+                if (!ReadString(p, end, data, size)) {
+                    return corrupted();
+                }
+                output += '>';
+                AppendEscaped(output, data, size, false);
+                output += "</";
+                output += name;
+                output += ">\n";
+            }
+            break;
+        }
+        case binary_markup: {
+            const char* data;
+            size_t size;
+            if (!ReadString(p, end, data, size)) {
+                return corrupted();
+            }
+            output += '<';
+            output.append(data, size);
+            output += ">\n";
+            break;
+        }
+        case binary_element_end:
+            if (names.empty()) {
+                return corrupted();
+            }
+            output += "</";
+            output += names.back();
+            output += ">\n";
+            names.pop_back();
+            break;
+        case binary_tc_run: {
+            if (end - p < 4) {
+                return corrupted();
+            }
+            uint32_t packed = 0;
+            for (int i = 0; i < 32; i += 8) {
+                packed |= (uint32_t)(uint8_t)*p++ << i;
+            }
+            uint64_t count;
+            if (packed >> 29 || !ReadVarint(p, end, count) || !count) {
+                return corrupted();
+            }
+            auto timecode = TimeCode32(packed).ToTimeCode(frames_max);
+            if (is_compact) {
+                output += "<tc v=\"";
+                output.append(timecode_text, timecode.ToString(timecode_text));
+                if (count > 1) {
+                    output += "\" frame_count=\"";
+                    output += to_string(count);
+                }
+                output += "\"/>\n";
+                break;
+            }
+            for (uint64_t i = 0; i < count; i++) {
+                output += "<tc v=\"";
+                output.append(timecode_text, timecode.ToString(timecode_text));
+                output += "\"/>\n";
+                timecode++;
+                FlushOutput(out, output);
+            }
+            break;
+        }
+        default:
+            return corrupted();
+        }
+        FlushOutput(out, output);
+    }
+}
+
+// Receives the cues of 1 track without merging, so 1 cue per frame, and builds the index segments
+struct index_builder : cue_visitor
+{
+    timecode_index_header   header{};
+    vector<timecode_index_segment> segments;
+    TimeCode                next_timecode;          // Expected timecode of the next frame if it continues the last segment
+    bool                    next_has_value = false;
+    size_t                  not_timecode_count = 0;
+    string                  decoded;
+    string                  error;
+
+    void Cue(const cue_struct& cue) override
+    {
+        if (!error.empty()) {
+            return;
+        }
+        if (cue.value_count != 1) {
+            error = "Error: a track_index is needed for indexing a file with several tracks\n";
+            return;
+        }
+        if (!header.frame_count) {
+            auto num = cue.time_base;
+            auto den = cue.end - cue.start;
+            auto g = gcd(num, den);
+            num /= g;
+            den /= g;
+            if (num > numeric_limits<uint32_t>::max() || den > numeric_limits<uint32_t>::max()) {
+                error = "Error: frame rate is not supported for indexing\n";
+                return;
+            }
+            header.frame_rate_num = (uint32_t)num;
+            header.frame_rate_den = (uint32_t)den;
+            header.frames_max = (uint32_t)(num / den - (num % den == 0));
+        }
+
+        const auto& value = cue.values[0];
+        TimeCode timecode;
+        bool has_value = true;
+        if (value.timecode) {
+            timecode = *value.timecode;
+        }
+        else if (value.raw.len) {
+            timecode.SetFramesMax(header.frames_max);
+            has_value = !RawToTimeCode(timecode, value.raw, decoded);
+            if (!has_value) {
+                not_timecode_count++;
+            }
+        }
+        else {
+            has_value = false;
+        }
+
+        auto frame = header.frame_count++;
+        bool is_new_segment = segments.empty() || has_value != next_has_value || (has_value && (timecode != next_timecode || timecode.GetFramesMax() != next_timecode.GetFramesMax() || Flags(timecode) != Flags(next_timecode)));
+        if (is_new_segment && has_value && !IsIndexable(timecode)) {
+            has_value = false;
+            not_timecode_count++;
+            is_new_segment = segments.empty() || next_has_value;
+        }
+        if (is_new_segment) {
+            timecode_index_segment segment{};
+            segment.first_frame = frame;
+            if (has_value) {
+                segment.hours = timecode.GetHours();
+                segment.frames = timecode.GetFrames();
+                segment.frames_max = timecode.GetFramesMax();
+                segment.minutes = timecode.GetMinutes();
+                segment.seconds = timecode.GetSeconds();
+                segment.flags = Flags(timecode);
+            }
+            segments.push_back(segment);
+        }
+        next_has_value = has_value;
+        if (has_value) {
+            next_timecode = timecode;
+            next_timecode++;
+        }
+    }
+
+    // Track with a start timecode and a frame count, indexed without walking the frames
+    bool Continuous(const TimeCode& timecode, long long frame_count, uint64_t frame_rate_num, uint64_t frame_rate_den)
+    {
+        auto g = gcd(frame_rate_num, frame_rate_den);
+        frame_rate_num /= g;
+        frame_rate_den /= g;
+        if (frame_count <= 0 || frame_rate_num > numeric_limits<uint32_t>::max() || frame_rate_den > numeric_limits<uint32_t>::max() || !IsIndexable(timecode)) {
+            return false; // Indexed frame by frame
+        }
+        header.frame_rate_num = (uint32_t)frame_rate_num;
+        header.frame_rate_den = (uint32_t)frame_rate_den;
+        header.frames_max = timecode.GetFramesMax();
+        header.frame_count = (uint64_t)frame_count;
+        timecode_index_segment segment{};
+        segment.hours = timecode.GetHours();
+        segment.frames = timecode.GetFrames();
+        segment.frames_max = timecode.GetFramesMax();
+        segment.minutes = timecode.GetMinutes();
+        segment.seconds = timecode.GetSeconds();
+        segment.flags = Flags(timecode);
+        segments.push_back(segment);
+        return true;
+    }
+
+    static uint8_t Flags(const TimeCode& timecode)
+    {
+        return timecode_index_has_value
+            | (timecode.GetDropFrame() ? timecode_index_drop_frame : 0)
+            | (timecode.Get1001() ? timecode_index_1001 : 0)
+            | (timecode.GetMustUseSecondField() ? timecode_index_must_use_second_field : 0)
+            | (timecode.GetIsSecondField() ? timecode_index_is_second_field : 0)
+            | (timecode.GetNegative() ? timecode_index_negative : 0)
+            | (timecode.GetIsTime() ? timecode_index_is_time : 0);
+    }
+
+    // The segment keeps only some fields of the timecode, check that the same timecode is rebuilt
+    static bool IsIndexable(const TimeCode& timecode)
+    {
+        timecode_index_segment segment{};
+        segment.hours = timecode.GetHours();
+        segment.frames = timecode.GetFrames();
+        segment.frames_max = timecode.GetFramesMax();
+        segment.minutes = timecode.GetMinutes();
+        segment.seconds = timecode.GetSeconds();
+        segment.flags = Flags(timecode);
+        char text[TimeCode::ToString_MaxSize];
+        char rebuilt_text[TimeCode::ToString_MaxSize];
+        auto size = timecode.ToString(text);
+        auto rebuilt = IndexTimeCode(segment);
+        auto rebuilt_size = rebuilt.ToString(rebuilt_text);
+        return size == rebuilt_size && !memcmp(text, rebuilt_text, size);
+    }
+
+    int Finish(string& index, ostream& err)
+    {
+        if (!error.empty()) {
+            err << error;
+            return 1;
+        }
+        if (not_timecode_count) {
+            err << "Warning: " << not_timecode_count << " values are not timecodes, they are indexed as frames without timecode\n";
+        }
+        memcpy(header.magic, "TCIX", 4);
+        header.version = 1;
+        header.segment_count = segments.size();
+        index.resize(sizeof(header) + segments.size() * sizeof(timecode_index_segment));
+        memcpy(&index[0], &header, sizeof(header));
+        if (!segments.empty()) {
+            memcpy(&index[sizeof(header)], segments.data(), segments.size() * sizeof(timecode_index_segment));
+        }
+        return 0;
+    }
+};
+
+// Returns 1 with the error message in err if a stream ended at a tc element with an invalid frame_count, else 0
+int InvalidFrameCountError(const vector<stream_struct>& streams, ostream& err)
+{
+    for (const auto& stream : streams) {
+        if (stream.has_invalid_frame_count) {
+            err << "Error: issue when parsing the frame_count attribute of a tc element\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Converts the input to WebVTT sent to out, or to cues sent to visitor
+// With indexer, a single track with a start timecode is sent directly to indexer
+// Returns 0 if all fine, else 1 with the error message in err
+int Convert(input_struct& input, const convert_options& options, output_sink* output_sink_, cue_visitor* visitor, ostream& err, index_builder* indexer = nullptr)
+{
+    auto track_index = options.track_index;
+    auto merge = options.merge;
+    auto thread_count = options.thread_count;
+    if (!input.is_partial && IsBinary(input.buf, input.len)) {
+        // Runs are expanded to tc elements with frame_count, so they are not parsed frame by frame
+        string_sink xml;
+        if (ReadBinary(input.buf, input.len, xml, true, err)) {
+            return 1;
+        }
+        input_struct xml_input;
+        xml_input.buf = xml.out.data();
+        xml_input.len = xml.out.size();
+        return Convert(xml_input, options, output_sink_, visitor, err, indexer);
+    }
+    if (input.len > (size_t)numeric_limits<tfsxml_size>::max()) {
+        err << "Error: input file too big\n";
+        return 1;
+    }
+
+    tfsxml_string xml_handle, n, v;
+    if (input.Init(xml_handle)) {
+        err << "Error: issue when parsing the XML input file\n";
+        return 1;
+    }
+    vector<stream_struct> streams;
+
+    // Parser calls, more content is read from standard input when needed
+    tfsxml_string* main_handle = &xml_handle;
+    auto next = [&](tfsxml_string& priv, tfsxml_string& name) {
+        int result;
+        while ((result = tfsxml_next(&priv, &name)) == TFSXML_NEED_MORE_DATA) {
+            input.Refill(main_handle, streams);
+        }
+        return result;
+    };
+    auto attr = [&](tfsxml_string& priv, tfsxml_string& name, tfsxml_string& value) {
+        int result;
+        while ((result = tfsxml_attr(&priv, &name, &value)) == TFSXML_NEED_MORE_DATA) {
+            input.Refill(main_handle, streams);
+        }
+        return result;
+    };
+    auto enter = [&](tfsxml_string& priv) {
+        int result;
+        while ((result = tfsxml_enter(&priv)) == TFSXML_NEED_MORE_DATA) {
+            input.Refill(main_handle, streams);
+        }
+        return result;
+    };
+
+    string output;
+    output.reserve(output_block_size + 0x1000);
+    size_t stream_pos = 0;
+    while (!next(xml_handle, n)) {
+        if (!tfsxml_strcmp_charp(n, "MediaTimecode")) {
+            enter(xml_handle);
+            while (!next(xml_handle, n)) {
+                if (!tfsxml_strcmp_charp(n, "media")) {
+                    output += "WEBVTT\n";
+                    enter(xml_handle);
+                    while (!next(xml_handle, n)) {
+                        if (!tfsxml_strcmp_charp(n, "timecode_stream")) {
+                            if (track_index != -1 && track_index != stream_pos++) {
+                                continue;
+                            }
+                            output += "\nNOTE";
+                            stream_struct stream;
+                            while (!attr(xml_handle, n, v)) {
+                                output += ' ';
+                                output += tfsxml_decode(n);
+                                output += '=';
+                                auto value = tfsxml_decode(v);
+                                output += value;
+                                if (!tfsxml_strcmp_charp(n, "frame_count")) {
+                                    stream.frame_count = ParseFrameCount(v);
+                                    if (stream.frame_count < 0) {
+                                        err << "Error: issue when parsing the frame_count attribute " << value << '\n';
+                                        return 1;
+                                    }
+                                }
+                                if (!tfsxml_strcmp_charp(n, "frame_rate")) {
+                                    uint64_t new_frame_rate_num, new_frame_rate_den;
+                                    if (!ParseRational(value, new_frame_rate_num, new_frame_rate_den)) {
+                                        err << "Error: issue when parsing the frame_rate attribute " << value << '\n';
+                                    }
+
+                                    // Handle "rounded" 1/1.001 fractions
+                                    if (value.find('.') != string::npos) {
+                                        Normalize1001(new_frame_rate_num, new_frame_rate_den);
+                                    }
+
+                                    stream.frame_rate_num = new_frame_rate_num;
+                                    stream.frame_rate_den = new_frame_rate_den;
+                                    auto FramesMax = new_frame_rate_num / new_frame_rate_den - (new_frame_rate_num % new_frame_rate_den == 0);
+                                    if (FramesMax > numeric_limits<uint32_t>::max()) {
+                                        return 1;
+                                    }
+                                    stream.timecode.SetFramesMax((uint32_t)FramesMax);
+                                }
+                                if (!tfsxml_strcmp_charp(n, "source")) {
+                                    stream.id = value;
+                                }
+                                if (!tfsxml_strcmp_charp(n, "id")) {
+                                    if (track_index == -1 && stream.id.empty()) {
+                                        stream.id = value;
+                                    }
+                                }
+                                if (!tfsxml_strcmp_charp(n, "start_tc")) {
+                                    stream.timecode.FromString(value);
+                                }
+                            }
+                            if (track_index == -1) {
+                                if (stream.id.size() < 40) {
+                                    stream.id.insert(stream.id.begin(), 40 - stream.id.size(), ' ');
+                                }
+                            }
+                            stream.id.insert(stream.id.begin(), 1, '\n');
+                            if (track_index == -1) {
+                                stream.id += ": ";
+                            }
+                            streams.push_back(stream);
+                            if (!stream.timecode.GetIsValid()) {
+                                auto& stream_handle = streams.back();
+                                stream_handle.xml_handle = xml_handle;
+                                stream_handle.xml_handle_is_used = true;
+                                if (enter(stream_handle.xml_handle)) {
+                                    err << "Error: issue when parsing the XML input file\n";
+                                    return 1;
+                                }
+                                if (next(stream_handle.xml_handle, stream_handle.n)) {
+                                    err << "Error: issue when parsing the XML input file\n";
+                                    return 1;
+                                }
+                            }
+                            if (track_index != -1) {
+                                goto streams_parsed; // Only this stream is needed, no need to parse the rest of the file
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+streams_parsed:
+    main_handle = nullptr;
+
+    // Common time line, in 1/time_base second units, each stream has a whole count of units per frame
+    // Streams without frame rate use the frame rate of the first stream having one
+    uint64_t frame_rate_num = 0;
+    uint64_t frame_rate_den = 0;
+    for (const auto& stream : streams) {
+        if (stream.frame_rate_num && stream.frame_rate_den) {
+            frame_rate_num = stream.frame_rate_num;
+            frame_rate_den = stream.frame_rate_den;
+            break;
+        }
+    }
+    if (!frame_rate_num || !frame_rate_den) {
+        err << "Error: frame rate is missing\n";
+        return 1;
+    }
+    if (indexer && streams.size() == 1 && streams[0].timecode.GetIsValid() && indexer->Continuous(streams[0].timecode, streams[0].frame_count, frame_rate_num, frame_rate_den)) {
+        return 0;
+    }
+    uint64_t time_base = 1;
+    for (auto& stream : streams) {
+        if (!stream.frame_rate_num || !stream.frame_rate_den) {
+            stream.frame_rate_num = frame_rate_num;
+            stream.frame_rate_den = frame_rate_den;
+        }
+        time_base = time_base / gcd(time_base, stream.frame_rate_num) * stream.frame_rate_num;
+        if (time_base > numeric_limits<uint32_t>::max()) {
+            err << "Error: frame rates can not be put on a common time line\n";
+            return 1;
+        }
+    }
+    for (auto& stream : streams) {
+        stream.frame_duration = stream.frame_rate_den * (time_base / stream.frame_rate_num);
+        if (stream.frame_duration > numeric_limits<uint32_t>::max()) {
+            err << "Error: frame rates can not be put on a common time line\n";
+            return 1;
+        }
+        if ((uint64_t)stream.frame_count > numeric_limits<uint64_t>::max() / stream.frame_duration) {
+            err << "Error: frame_count can not be put on a common time line\n";
+            return 1;
+        }
+    }
+
+    // Maximum duration of a cue
+    uint64_t merge_duration = 0;
+    switch (merge) {
+    case merge_second:
+        merge_duration = time_base;
+        output += "\nNOTE each cue lasts up to 1 second and shows the timecodes of its first frame, timecodes increment by 1 per frame within a cue";
+        break;
+    case merge_segment:
+        merge_duration = (uint64_t)-1;
+        output += "\nNOTE each cue shows the timecodes of its first frame, timecodes increment by 1 per frame within a cue";
+        break;
+    default:;
+    }
+
+    output += "\n"
+        "\n"
+        "::cue {\n"
+        "    color: white;\n"
+        "    background - color: black;\n"
+        "    font - family: monospace;\n"
+        "};\n"
+        "\n";
+
+    if (visitor) {
+        // Same cues as the WebVTT output, values are provided as is, without formatting
+        // Raw values point to the input buffer, so the buffer must not be refilled
+        if (input.is_partial) {
+            err << "Error: cues of standard input can not be visited\n";
+            return 1;
+        }
+
+        // Value of a stream with tc elements for the current frame
+        auto read_raw = [&](stream_struct& stream, cue_track_value& value) {
+            value = cue_track_value();
+            if (stream.run_count) {
+                if (stream.run_is_timecode) {
+                    stream.visit_timecode = stream.run_timecode;
+                    value.timecode = &stream.visit_timecode;
+                    stream.run_timecode++;
+                }
+                else {
+                    value.raw = stream.run_raw;
+                }
+                stream.run_count--;
+                return;
+            }
+            if (!tfsxml_strcmp_charp(stream.n, "tc")) {
+                long long frame_count = 1;
+                tfsxml_string attr_value;
+                while (!attr(stream.xml_handle, stream.n, attr_value)) {
+                    if (!tfsxml_strcmp_charp(stream.n, "v")) {
+                        value.raw = attr_value;
+                    }
+                    if (!tfsxml_strcmp_charp(stream.n, "frame_count")) {
+                        frame_count = ParseFrameCount(attr_value);
+                    }
+                }
+                if (frame_count < 0) {
+                    stream.has_invalid_frame_count = true;
+                    stream.xml_handle_is_used = false;
+                    return;
+                }
+                if (frame_count > 1) {
+                    // Next values are computed, 1 per frame
+                    stream.run_timecode = stream.timecode;
+                    stream.run_is_timecode = !RawToTimeCode(stream.run_timecode, value.raw, stream.visit_decoded);
+                    if (stream.run_is_timecode) {
+                        stream.run_timecode++;
+                    }
+                    else {
+                        stream.run_raw = value.raw;
+                    }
+                    stream.run_count = frame_count - 1;
+                }
+            }
+            if (next(stream.xml_handle, stream.n)) {
+                stream.xml_handle_is_used = false;
+            }
+        };
+
+        vector<cue_track_value> values(streams.size());
+        vector<cue_track_value> cue_values(streams.size());
+        vector<TimeCode> cue_timecodes(streams.size());
+        auto unfinished_stream_count = streams.size();
+        uint64_t time = 0;
+        cue_struct cue;
+        cue.time_base = time_base;
+        cue.values = cue_values.data();
+        cue.value_count = cue_values.size();
+        bool is_cue_open = false;
+        for (;;) {
+            bool is_continuous = is_cue_open && time - cue.start < merge_duration;
+            for (size_t i = 0; i < streams.size(); i++) {
+                auto& stream = streams[i];
+                auto& value = values[i];
+                if (stream.is_finished || stream.next_time != time) {
+                    continue;
+                }
+                stream.next_time += stream.frame_duration;
+                bool has_frame = stream.timecode.GetIsValid() ? stream.frame_count != 0 : (stream.run_count || stream.xml_handle_is_used);
+                if (!has_frame) {
+                    value = cue_track_value();
+                    stream.is_finished = true;
+                    unfinished_stream_count--;
+                    is_continuous = false;
+                    continue;
+                }
+                if (stream.timecode.GetIsValid()) {
+                    if (stream.is_started) {
+                        stream.timecode++;
+                    }
+                    stream.is_started = true;
+                    stream.frame_count--;
+                    value.timecode = &stream.timecode;
+                    continue;
+                }
+                read_raw(stream, value);
+                if (merge_duration) {
+                    // Timecodes are compared as values, raw values without timecode are expected only if empty after a value without timecode
+                    TimeCode timecode = stream.timecode;
+                    bool is_timecode = true;
+                    if (value.timecode) {
+                        timecode = *value.timecode;
+                    }
+                    else {
+                        is_timecode = value.raw.len && !RawToTimeCode(timecode, value.raw, stream.visit_decoded);
+                    }
+                    if (is_timecode ? !stream.visit_has_next || timecode != stream.visit_next_timecode : value.raw.len || stream.visit_has_next) {
+                        is_continuous = false;
+                    }
+                    stream.visit_has_next = is_timecode;
+                    if (is_timecode) {
+                        timecode++;
+                        stream.visit_next_timecode = timecode;
+                    }
+                }
+            }
+            if (!is_continuous) {
+                if (is_cue_open) {
+                    cue.end = time;
+                    visitor->Cue(cue);
+                }
+                if (!unfinished_stream_count) {
+                    break;
+                }
+                cue.start = time;
+                is_cue_open = true;
+                for (size_t i = 0; i < streams.size(); i++) {
+                    cue_values[i] = values[i];
+                    if (values[i].timecode) {
+                        cue_timecodes[i] = *values[i].timecode;
+                        cue_values[i].timecode = &cue_timecodes[i];
+                    }
+                }
+            }
+
+            // Next frame start of any stream
+            uint64_t next_time = (uint64_t)-1;
+            for (const auto& stream : streams) {
+                if (!stream.is_finished && stream.next_time < next_time) {
+                    next_time = stream.next_time;
+                }
+            }
+            time = next_time;
+        }
+        return InvalidFrameCountError(streams, err);
+    }
+    auto& out = *output_sink_;
+
+    // Value of a stream with tc elements for the current frame
+    auto read_value = [&](stream_struct& stream, string& content) {
+        if (stream.run_count) {
+            if (stream.run_is_timecode) {
+                char timecode[TimeCode::ToString_MaxSize];
+                content.append(timecode, stream.run_timecode.ToString(timecode));
+                stream.run_timecode++;
+            }
+            else {
+                content += stream.run_value;
+            }
+            stream.run_count--;
+            return;
+        }
+        if (!tfsxml_strcmp_charp(stream.n, "tc")) {
+            auto value_pos = content.size();
+            long long frame_count = 1;
+            tfsxml_string value;
+            while (!attr(stream.xml_handle, stream.n, value)) {
+                if (!tfsxml_strcmp_charp(stream.n, "v")) {
+                    value_pos = content.size();
+                    tfsxml_decode(content, value);
+                }
+                if (!tfsxml_strcmp_charp(stream.n, "frame_count")) {
+                    frame_count = ParseFrameCount(value);
+                }
+            }
+            if (frame_count < 0) {
+                stream.has_invalid_frame_count = true;
+                stream.xml_handle_is_used = false;
+                return;
+            }
+            if (frame_count > 1) {
+                // Next values are computed, 1 per frame
+                stream.run_timecode = stream.timecode;
+                stream.run_is_timecode = !stream.run_timecode.FromString(content.c_str() + value_pos, content.size() - value_pos);
+                if (stream.run_is_timecode) {
+                    stream.run_timecode++;
+                }
+                else {
+                    stream.run_value.assign(content, value_pos, string::npos);
+                }
+                stream.run_count = frame_count - 1;
+            }
+        }
+        if (next(stream.xml_handle, stream.n)) {
+            stream.xml_handle_is_used = false;
+        }
+    };
+
+    // Values of the next frames of a stream, stops early if the stream has no more frames
+    // Streams are independent so they are computed in parallel, except for standard input which is shared
+    auto compute_block = [&](stream_struct& stream) {
+        if (merge_duration && stream.timecode.GetIsValid()) {
+            return;
+        }
+        stream.block_values.clear();
+        stream.block_ends.clear();
+        stream.block_is_expected.clear();
+        stream.block_pos = 0;
+        if (stream.timecode.GetIsValid()) {
+            auto count = stream.block_frame_count;
+            if (stream.frame_count >= 0 && (unsigned long long)stream.frame_count < count) {
+                count = (size_t)stream.frame_count;
+            }
+            AppendTimeCodesDispatch(stream.timecode, count, stream.block_values, stream.block_ends);
+            stream.frame_count -= count;
+            return;
+        }
+        for (size_t i = 0; i < stream.block_frame_count; i++) {
+            if (!stream.run_count && !stream.xml_handle_is_used) {
+                break;
+            }
+            read_value(stream, stream.block_values);
+            stream.block_ends.push_back(stream.block_values.size());
+        }
+
+        // With merged cues, values of the block are parsed in bulk once the block is read, then compared to the expected values
+        if (merge_duration) {
+            auto count = stream.block_ends.size();
+            stream.block_value_data.resize(count);
+            stream.block_value_sizes.resize(count);
+            stream.block_timecodes.resize(count);
+            size_t value_pos = 0;
+            for (size_t i = 0; i < count; i++) {
+                stream.block_value_data[i] = stream.block_values.data() + value_pos;
+                stream.block_value_sizes[i] = stream.block_ends[i] - value_pos;
+                value_pos = stream.block_ends[i];
+            }
+            stream.timecode.FromStrings(stream.block_value_data.data(), stream.block_value_sizes.data(), count, stream.block_timecodes.data());
+            for (size_t i = 0; i < count; i++) {
+                auto value_size = stream.block_value_sizes[i];
+                stream.block_is_expected.push_back(value_size == stream.next_value.size() && !memcmp(stream.block_value_data[i], stream.next_value.data(), value_size));
+
+                // Expected value for the next frame
+                auto& timecode = stream.block_timecodes[i];
+                stream.next_value.clear();
+                if (value_size && timecode.GetIsValid()) {
+                    timecode++;
+                    char next_timecode[TimeCode::ToString_MaxSize];
+                    stream.next_value.append(next_timecode, timecode.ToString(next_timecode));
+                }
+            }
+        }
+    };
+
+    // Blocks last about 4096 frames of the stream with the highest frame rate
+    uint64_t block_duration = (uint64_t)-1;
+    for (const auto& stream : streams) {
+        block_duration = min(block_duration, stream.frame_duration);
+    }
+    block_duration *= 4096;
+
+    // Moves a stream to its next frame, returns false if the stream has no more frames
+    // With merged cues, continuous streams are not in blocks, their values are computed only for the first frame of a cue
+    auto advance = [&](stream_struct& stream, bool& is_continuous) {
+        if (merge_duration && stream.timecode.GetIsValid()) {
+            if (!stream.frame_count) {
+                return false;
+            }
+            if (stream.is_started) {
+                stream.timecode++;
+            }
+            stream.is_started = true;
+            stream.frame_count--;
+            return true;
+        }
+        auto pos = stream.block_pos;
+        if (pos == stream.block_ends.size()) {
+            stream.value_size = 0;
+            return false;
+        }
+        auto begin = pos ? stream.block_ends[pos - 1] : 0;
+        stream.value = stream.block_values.data() + begin;
+        stream.value_size = stream.block_ends[pos] - begin;
+        if (merge_duration && !stream.block_is_expected[pos]) {
+            is_continuous = false;
+        }
+        stream.block_pos++;
+        return true;
+    };
+
+    // Cues from time to time_end, streams are at time
+    // Cues start at each frame of each stream, or when a timecode does not increment by 1 per frame if cues are merged
+    // Only the first values of a cue are output
+    auto convert = [&](vector<stream_struct>& streams, uint64_t time, uint64_t time_end, string& output, worker_pool& workers, bool is_flushed) {
+        auto compute_block_task = function<void(size_t)>([&](size_t i) {
+            compute_block(streams[i]);
+        });
+        uint64_t block_end = time;
+        size_t unfinished_stream_count = 0;
+        for (const auto& stream : streams) {
+            unfinished_stream_count += !stream.is_finished;
+        }
+        CueTime time_stamp(time, streams.empty() ? 0 : streams[0].frame_duration, time_base);
+        string cue_start;
+        uint64_t cue_start_time = 0;
+        bool is_cue_open = false;
+        auto write_cue = [&]() {
+            output += '\n';
+            output += cue_start;
+            output += " --> ";
+            output.append(time_stamp.data(), time_stamp.size());
+            for (auto& stream : streams) {
+                output += stream.id;
+                output += stream.cue_value;
+            }
+            output += '\n';
+            if (is_flushed) {
+                FlushOutput(out, output);
+            }
+        };
+        while (time < time_end) {
+            if (time >= block_end) {
+                // Next block of values, current values are kept because they may last after the end of the previous block
+                block_end = time + block_duration;
+                for (auto& stream : streams) {
+                    if (stream.value != stream.value_copy.data()) {
+                        stream.value_copy.assign(stream.value, stream.value_size);
+                        stream.value = stream.value_copy.data();
+                    }
+                    stream.block_frame_count = 0;
+                    if (!stream.is_finished && stream.next_time < block_end) {
+                        stream.block_frame_count = (block_end - stream.next_time + stream.frame_duration - 1) / stream.frame_duration;
+                    }
+                }
+                workers.Run(streams.size(), compute_block_task);
+            }
+
+            bool is_continuous = is_cue_open && time - cue_start_time < merge_duration;
+            for (auto& stream : streams) {
+                if (stream.is_finished || stream.next_time != time) {
+                    continue;
+                }
+                stream.next_time += stream.frame_duration;
+                if (!advance(stream, is_continuous)) {
+                    stream.is_finished = true;
+                    unfinished_stream_count--;
+                    is_continuous = false;
+                }
+            }
+            if (!unfinished_stream_count) {
+                break;
+            }
+
+            // Next frame start of any stream
+            uint64_t next_time = (uint64_t)-1;
+            for (const auto& stream : streams) {
+                if (!stream.is_finished && stream.next_time < next_time) {
+                    next_time = stream.next_time;
+                }
+            }
+
+            if (!merge_duration) {
+                // 1 cue per frame start, values are output directly
+                output += '\n';
+                output.append(time_stamp.data(), time_stamp.size());
+                time_stamp.Next(next_time - time);
+                output += " --> ";
+                output.append(time_stamp.data(), time_stamp.size());
+                for (auto& stream : streams) {
+                    output += stream.id;
+                    output.append(stream.value, stream.value_size);
+                }
+                output += '\n';
+                if (is_flushed) {
+                    FlushOutput(out, output);
+                }
+                time = next_time;
+                continue;
+            }
+
+            if (!is_continuous) {
+                if (is_cue_open) {
+                    write_cue();
+                }
+                cue_start.assign(time_stamp.data(), time_stamp.size());
+                cue_start_time = time;
+                is_cue_open = true;
+                for (auto& stream : streams) {
+                    if (stream.timecode.GetIsValid()) {
+                        stream.cue_value.clear();
+                        if (!stream.is_finished) {
+                            char timecode[TimeCode::ToString_MaxSize];
+                            stream.cue_value.append(timecode, stream.timecode.ToString(timecode));
+                        }
+                    }
+                    else {
+                        stream.cue_value.assign(stream.value, stream.value_size);
+                    }
+                }
+            }
+            time_stamp.Next(next_time - time);
+            time = next_time;
+        }
+        if (is_cue_open) {
+            write_cue();
+        }
+    };
+
+    // Values of continuous streams are computed directly at any frame, so the time line can be split into shards converted in parallel
+    // Shards start at a frame start of all streams and last about 65536 frames of the stream with the highest frame rate
+    worker_pool workers(input.is_partial ? 1 : thread_count);
+    bool is_sharded = !input.is_partial && thread_count > 1 && !merge_duration && !streams.empty();
+    uint64_t shard_duration = 1;
+    uint64_t duration = 0;
+    for (const auto& stream : streams) {
+        if (!stream.timecode.GetIsValid()) {
+            is_sharded = false; // Values of tc elements are known only after parsing the previous elements
+        }
+        shard_duration = shard_duration / gcd(shard_duration, stream.frame_duration) * stream.frame_duration;
+        if (shard_duration > numeric_limits<uint32_t>::max()) {
+            is_sharded = false;
+            break;
+        }
+        if (stream.frame_count > 0) {
+            duration = max(duration, (uint64_t)stream.frame_count * stream.frame_duration);
+        }
+    }
+    if (is_sharded) {
+        shard_duration *= (block_duration * 16 + shard_duration - 1) / shard_duration;
+        FlushOutput(out, output, true);
+        vector<string> shard_outputs(thread_count);
+        vector<TimeCodeRate> stream_rates;
+        for (const auto& stream : streams) {
+            stream_rates.emplace_back(stream.timecode.GetFramesMax(), stream.timecode.GetDropFrame());
+        }
+        uint64_t shard_time = 0;
+        auto convert_shard_task = function<void(size_t)>([&](size_t i) {
+            auto time = shard_time + i * shard_duration;
+            auto& shard_output = shard_outputs[i];
+            shard_output.clear();
+            if (time >= duration) {
+                return;
+            }
+            auto shard_streams = streams;
+            for (size_t j = 0; j < shard_streams.size(); j++) {
+                auto& stream = shard_streams[j];
+                auto frame_pos = (long long)(time / stream.frame_duration);
+                stream.next_time = time;
+                if (stream.frame_count > frame_pos) {
+                    AddFrames(stream.timecode, frame_pos, stream_rates[j]);
+                    stream.frame_count -= frame_pos;
+                }
+                else {
+                    stream.frame_count = 0;
+                }
+            }
+            worker_pool shard_workers(1);
+            convert(shard_streams, time, time + shard_duration, shard_output, shard_workers, false);
+        });
+        while (shard_time < duration) {
+            workers.Run(thread_count, convert_shard_task);
+            for (const auto& shard_output : shard_outputs) {
+                out.Write(shard_output.data(), shard_output.size());
+            }
+            shard_time += thread_count * shard_duration;
+        }
+    }
+    else {
+        convert(streams, 0, (uint64_t)-1, output, workers, true);
+    }
+
+    FlushOutput(out, output, true);
+    return InvalidFrameCountError(streams, err);
+}
+
+int Index(input_struct& input, size_t track_index, string& index, ostream& err)
+{
+    uint16_t byte_order = 1;
+    if (!*(const char*)&byte_order) {
+        err << "Error: indexes are supported only on little-endian hosts\n";
+        return 1;
+    }
+    convert_options options;
+    options.track_index = track_index;
+    index_builder builder;
+    if (Convert(input, options, nullptr, &builder, err, &builder)) {
+        return 1;
+    }
+    return builder.Finish(index, err);
+}
+
+} // namespace
+
+int ConvertBuffer(const char* buf, size_t len, const convert_options& options, output_sink& output, string& error)
+{
+    input_struct input;
+    input.buf = buf;
+    input.len = len;
+    ostringstream err;
+    auto result = Convert(input, options, &output, nullptr, err);
+    error = err.str();
+    return result;
+}
+
+int ConvertFile(const char* file_name, const convert_options& options, output_sink& output, string& error)
+{
+    input_struct input;
+    if (!strcmp(file_name, "-")) {
+        input.is_partial = true;
+    }
+    else if (!input.Map(file_name) && !input.Read(file_name)) {
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    ostringstream err;
+    auto result = Convert(input, options, &output, nullptr, err);
+    error = err.str();
+    return result;
+}
+
+int VisitBuffer(const char* buf, size_t len, const convert_options& options, cue_visitor& visitor, string& error)
+{
+    input_struct input;
+    input.buf = buf;
+    input.len = len;
+    ostringstream err;
+    auto result = Convert(input, options, nullptr, &visitor, err);
+    error = err.str();
+    return result;
+}
+
+int VisitFile(const char* file_name, const convert_options& options, cue_visitor& visitor, string& error)
+{
+    input_struct input;
+    if (!input.Map(file_name) && !input.Read(file_name)) {
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    ostringstream err;
+    auto result = Convert(input, options, nullptr, &visitor, err);
+    error = err.str();
+    return result;
+}
+
+int IndexBuffer(const char* buf, size_t len, size_t track_index, string& index, string& error)
+{
+    input_struct input;
+    input.buf = buf;
+    input.len = len;
+    ostringstream err;
+    auto result = Index(input, track_index, index, err);
+    error = err.str();
+    return result;
+}
+
+int IndexFile(const char* file_name, size_t track_index, string& index, string& error)
+{
+    input_struct input;
+    if (!input.Map(file_name) && !input.Read(file_name)) {
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    ostringstream err;
+    auto result = Index(input, track_index, index, err);
+    error = err.str();
+    return result;
+}
+
+struct timecode_index::file_struct
+{
+    input_struct    input;
+};
+
+// Runs of timecodes sorted by position in the day (ToFrames), per frame rate
+struct timecode_index::search_struct
+{
+    struct range
+    {
+        uint64_t        begin;              // Position of the first timecode, or 0 for the part after midnight
+        uint64_t        end;                // Position after the last timecode in the day
+        uint64_t        position;           // Position of the timecode at first_frame
+        uint64_t        first_frame;
+        uint64_t        frame_count;
+    };
+
+    struct group
+    {
+        uint32_t        frames_max;
+        bool            drop_frame;
+        uint64_t        day_frame_count;
+        vector<range>   ranges;             // Sorted by begin
+        vector<uint64_t> max_ends;          // Max of end of the ranges up to this one
+    };
+
+    // Frames with timecodes without position (dropped frame numbers, hours after 24, fields...)
+    // Frames of short runs (e.g. the leading dropped frame numbers of a run) are sorted by value, other runs are compared frame by frame
+    struct value
+    {
+        uint64_t        time;               // Hours, minutes and seconds, as compared by TimeCode
+        uint32_t        frames;
+        uint64_t        frame;
+
+        bool operator<(const value& other) const
+        {
+            return time != other.time ? time < other.time : frames != other.frames ? frames < other.frames : frame < other.frame;
+        }
+    };
+
+    struct other
+    {
+        size_t          segment;
+        uint64_t        frame_count;
+    };
+
+    vector<group>       groups;
+    vector<value>       values;
+    vector<other>       others;
+    vector<TimeCodeRate> rates;             // Rates of the segments, for computing the timecodes of frames
+
+    static uint64_t Time(const TimeCode& timecode)
+    {
+        return (uint64_t)timecode.GetHours() << 16 | (uint64_t)timecode.GetMinutes() << 8 | timecode.GetSeconds();
+    }
+
+    void AddOthers(const timecode_index_segment& segment, size_t segment_index, uint64_t frame_count, uint64_t short_count)
+    {
+        if (frame_count > short_count) {
+            others.push_back({segment_index, frame_count});
+            return;
+        }
+        auto timecode = IndexTimeCode(segment);
+        for (uint64_t i = 0; i < frame_count; i++) {
+            values.push_back({Time(timecode), timecode.GetFrames(), segment.first_frame + i});
+            timecode++;
+        }
+    }
+
+    const TimeCodeRate* Rate(uint32_t frames_max, bool drop_frame) const
+    {
+        for (const auto& rate : rates) {
+            if (rate.GetFramesMax() == frames_max && rate.GetDropFrame() == drop_frame) {
+                return &rate;
+            }
+        }
+        return nullptr;
+    }
+};
+
+timecode_index::timecode_index()
+    : file(nullptr)
+    , search(nullptr)
+    , header(nullptr)
+    , segments(nullptr)
+{
+}
+
+timecode_index::~timecode_index()
+{
+    delete search;
+    delete file;
+}
+
+int timecode_index::Open(const char* buf, size_t len, string& error)
+{
+    header = nullptr;
+    segments = nullptr;
+    delete search;
+    search = nullptr;
+    uint16_t byte_order = 1;
+    if (!*(const char*)&byte_order) {
+        error = "Error: indexes are supported only on little-endian hosts\n";
+        return 1;
+    }
+    if ((uintptr_t)buf % alignof(timecode_index_header)) {
+        error = "Error: index buffer is not aligned\n";
+        return 1;
+    }
+    auto index_header = (const timecode_index_header*)buf;
+    if (len < sizeof(timecode_index_header) || memcmp(index_header->magic, "TCIX", 4)) {
+        error = "Error: not an index\n";
+        return 1;
+    }
+    if (index_header->version != 1) {
+        error = "Error: index version is not supported\n";
+        return 1;
+    }
+    if (index_header->segment_count != (len - sizeof(timecode_index_header)) / sizeof(timecode_index_segment)
+     || (len - sizeof(timecode_index_header)) % sizeof(timecode_index_segment)
+     || (index_header->frame_count && !index_header->segment_count)
+     || index_header->frame_count >= ((uint64_t)1 << 62)) {
+        error = "Error: index is truncated or corrupted\n";
+        return 1;
+    }
+    // Segments are used as is, so segments not sorted by frame or with values the timecodes can not take (frame rate overflowing,
+    // count of frames of the hours overflowing) are rejected, minutes, seconds and frames are kept as in the XML even if not valid
+    auto index_segments = (const timecode_index_segment*)(buf + sizeof(timecode_index_header));
+    for (size_t i = 0; i < index_header->segment_count; i++) {
+        const auto& segment = index_segments[i];
+        if ((i ? segment.first_frame <= index_segments[i - 1].first_frame : segment.first_frame != 0)
+         || segment.first_frame >= index_header->frame_count
+         || ((segment.flags & timecode_index_has_value)
+          && (segment.frames_max == numeric_limits<uint32_t>::max()
+           || segment.hours >= ((uint64_t)1 << 62) / (3600 * ((uint64_t)segment.frames_max + 1))))) {
+            error = "Error: index is truncated or corrupted\n";
+            return 1;
+        }
+    }
+    header = index_header;
+    segments = index_segments;
+
+    search = new search_struct;
+    for (size_t i = 0; i < header->segment_count; i++) {
+        const auto& segment = segments[i];
+        auto end_frame = i + 1 < header->segment_count ? segments[i + 1].first_frame : header->frame_count;
+        if (!(segment.flags & timecode_index_has_value) || end_frame <= segment.first_frame) {
+            continue;
+        }
+        auto frame_count = end_frame - segment.first_frame;
+
+        // Leading dropped frame numbers are compared frame by frame
+        auto timecode = IndexTimeCode(segment);
+        auto rate = search->Rate(timecode.GetFramesMax(), timecode.GetDropFrame());
+        if (!rate) {
+            search->rates.emplace_back(timecode.GetFramesMax(), timecode.GetDropFrame());
+            rate = &search->rates.back();
+        }
+        auto try_count = ComputableTryCount(timecode);
+        uint64_t skip = 0;
+        while (skip < frame_count && skip < try_count && !IsComputable(timecode, *rate)) {
+            timecode++;
+            skip++;
+        }
+        if (skip == frame_count || !IsComputable(timecode, *rate)) {
+            search->AddOthers(segment, i, frame_count, try_count);
+            continue;
+        }
+        search->AddOthers(segment, i, skip, try_count);
+
+        auto frames_max = timecode.GetFramesMax();
+        auto drop_frame = timecode.GetDropFrame();
+        search_struct::group* group = nullptr;
+        for (auto& item : search->groups) {
+            if (item.frames_max == frames_max && item.drop_frame == drop_frame) {
+                group = &item;
+            }
+        }
+        if (!group) {
+            search->groups.push_back({frames_max, drop_frame, (uint64_t)rate->GetDayFrameCount(), {}, {}});
+            group = &search->groups.back();
+        }
+
+        // Runs crossing midnight are split in 2 ranges
+        search_struct::range range;
+        range.position = (uint64_t)rate->ToFrames(timecode);
+        range.first_frame = segment.first_frame + skip;
+        range.frame_count = frame_count - skip;
+        range.begin = range.position;
+        range.end = range.position + min(range.frame_count, group->day_frame_count);
+        if (range.end > group->day_frame_count) {
+            auto after_midnight = range;
+            after_midnight.begin = 0;
+            after_midnight.end = range.end - group->day_frame_count;
+            group->ranges.push_back(after_midnight);
+            range.end = group->day_frame_count;
+        }
+        group->ranges.push_back(range);
+    }
+    sort(search->values.begin(), search->values.end());
+    for (auto& group : search->groups) {
+        sort(group.ranges.begin(), group.ranges.end(), [](const search_struct::range& a, const search_struct::range& b) {
+            return a.begin < b.begin;
+        });
+        uint64_t max_end = 0;
+        group.max_ends.reserve(group.ranges.size());
+        for (const auto& range : group.ranges) {
+            max_end = max(max_end, range.end);
+            group.max_ends.push_back(max_end);
+        }
+    }
+    return 0;
+}
+
+int timecode_index::OpenFile(const char* file_name, string& error)
+{
+    delete file;
+    file = new file_struct;
+    if (!file->input.Map(file_name) && !file->input.Read(file_name)) {
+        delete file;
+        file = nullptr;
+        header = nullptr;
+        segments = nullptr;
+        delete search;
+        search = nullptr;
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    return Open(file->input.buf, file->input.len, error);
+}
+
+bool timecode_index::Get(uint64_t frame, TimeCode& timecode) const
+{
+    if (!header || frame >= header->frame_count) {
+        return false;
+    }
+
+    // Last segment starting at or before the frame
+    size_t begin = 0;
+    size_t end = (size_t)header->segment_count;
+    while (end - begin > 1) {
+        auto middle = begin + (end - begin) / 2;
+        if (segments[middle].first_frame <= frame) {
+            begin = middle;
+        }
+        else {
+            end = middle;
+        }
+    }
+    const auto& segment = segments[begin];
+    if (!(segment.flags & timecode_index_has_value)) {
+        return false;
+    }
+    timecode = IndexTimeCode(segment);
+    auto rate = search ? search->Rate(timecode.GetFramesMax(), timecode.GetDropFrame()) : nullptr;
+    if (rate) {
+        AddFrames(timecode, (long long)(frame - segment.first_frame), *rate);
+    }
+    else {
+        AddFrames(timecode, (long long)(frame - segment.first_frame));
+    }
+    return true;
+}
+
+bool timecode_index::Find(const TimeCode& timecode, vector<uint64_t>& frames) const
+{
+    frames.clear();
+    if (!search) {
+        return false;
+    }
+
+    for (const auto& group : search->groups) {
+        if (timecode.GetHours() >= 24 || timecode.GetFrames() > group.frames_max) {
+            continue;
+        }
+        auto position = (uint64_t)search->Rate(group.frames_max, group.drop_frame)->ToFrames(TimeCode(timecode.GetHours(), timecode.GetMinutes(), timecode.GetSeconds(), timecode.GetFrames(), group.frames_max, group.drop_frame));
+
+        // Ranges beginning at or before the position, until no previous range ends after the position
+        auto i = (size_t)(upper_bound(group.ranges.begin(), group.ranges.end(), position, [](uint64_t value, const search_struct::range& range) {
+            return value < range.begin;
+        }) - group.ranges.begin());
+        while (i && group.max_ends[i - 1] > position) {
+            const auto& range = group.ranges[--i];
+            if (position >= range.end) {
+                continue;
+            }
+            for (auto offset = (position + group.day_frame_count - range.position) % group.day_frame_count; offset < range.frame_count; offset += group.day_frame_count) {
+                frames.push_back(range.first_frame + offset);
+            }
+        }
+    }
+
+    // The position of a timecode which is not valid (e.g. a dropped frame number) may be the one of another timecode
+    TimeCode check;
+    frames.erase(remove_if(frames.begin(), frames.end(), [&](uint64_t frame) {
+        return !Get(frame, check) || check != timecode;
+    }), frames.end());
+
+    search_struct::value key{search_struct::Time(timecode), timecode.GetFrames(), 0};
+    for (auto value = lower_bound(search->values.begin(), search->values.end(), key); value != search->values.end() && value->time == key.time && value->frames == key.frames; ++value) {
+        frames.push_back(value->frame);
+    }
+    for (const auto& other : search->others) {
+        auto value = IndexTimeCode(segments[other.segment]);
+        for (uint64_t i = 0; i < other.frame_count; i++) {
+            if (value == timecode) {
+                frames.push_back(segments[other.segment].first_frame + i);
+            }
+            value++;
+        }
+    }
+
+    sort(frames.begin(), frames.end());
+    return !frames.empty();
+}
+
+bool IsBinary(const char* buf, size_t len)
+{
+    return len >= binary_header_size && !memcmp(buf, binary_magic, sizeof(binary_magic));
+}
+
+int XmlToBinary(const char* buf, size_t len, string& binary, string& error)
+{
+    input_struct input;
+    input.buf = buf;
+    input.len = len;
+    ostringstream err;
+    auto result = WriteBinary(input, binary, err);
+    error = err.str();
+    return result;
+}
+
+int XmlFileToBinary(const char* file_name, string& binary, string& error)
+{
+    input_struct input;
+    if (!input.Map(file_name) && !input.Read(file_name)) {
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    ostringstream err;
+    auto result = WriteBinary(input, binary, err);
+    error = err.str();
+    return result;
+}
+
+int BinaryToXml(const char* buf, size_t len, output_sink& output, string& error)
+{
+    ostringstream err;
+    auto result = ReadBinary(buf, len, output, false, err);
+    error = err.str();
+    return result;
+}
+
+int BinaryFileToXml(const char* file_name, output_sink& output, string& error)
+{
+    input_struct input;
+    if (!input.Map(file_name) && !input.Read(file_name)) {
+        error = "Error: can not read the file in full\n";
+        return 1;
+    }
+    ostringstream err;
+    auto result = ReadBinary(input.buf, input.len, output, false, err);
+    error = err.str();
+    return result;
+}
+
+} // namespace timecodexml
@@ -0,0 +1,181 @@
+/*
+ * MediaTimecode XML to WebVTT conversion library
+ */
+
+//---------------------------------------------------------------------------
+#ifndef TimeCodeXmlH
+#define TimeCodeXmlH
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+#include "tfsxml.h"
+#include "TimeCode.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+
+// API of the library, in the timecodexml namespace (TimeCode stays in the global namespace)
+// Conversions do not share any state, so several conversions may run at the same time in different threads
+namespace timecodexml
+{
+
+enum merge_mode
+{
+    merge_none,
+    merge_second,
+    merge_segment,
+};
+
+struct convert_options
+{
+    size_t          track_index = (size_t)-1;   // 0-based index of the only track to output, -1 for all tracks
+    merge_mode      merge = merge_none;
+    size_t          thread_count = 1;           // Count of threads used by 1 conversion
+};
+
+// Receives the WebVTT text, by blocks of about 64 KiB
+struct output_sink
+{
+    virtual ~output_sink() {}
+    virtual void Write(const char* data, size_t size) = 0;
+};
+
+struct ostream_sink : output_sink
+{
+    std::ostream&   out;
+
+    explicit ostream_sink(std::ostream& out_) : out(out_) {}
+    void Write(const char* data, size_t size) override { out.write(data, (std::streamsize)size); }
+};
+
+// Converts MediaTimecode XML content to WebVTT, the buffer is not copied and must stay valid during the conversion
+// Returns 0 if all fine, else 1 with the error messages in error (error may also have messages about non fatal issues)
+int ConvertBuffer(const char* buf, size_t len, const convert_options& options, output_sink& output, std::string& error);
+
+// Same as ConvertBuffer with a file, memory mapped if possible, - for standard input
+int ConvertFile(const char* file_name, const convert_options& options, output_sink& output, std::string& error);
+
+// Value of a track during a cue
+struct cue_track_value
+{
+    const TimeCode* timecode = nullptr; // Value if the track has a start timecode or if the value is computed from a tc element with frame_count
+    tfsxml_string   raw{};              // Else v attribute of the tc element as is (use tfsxml_decode if needed), empty if no value
+};
+
+// Cue from start/time_base to end/time_base seconds, with the values of the tracks at the start of the cue
+struct cue_struct
+{
+    uint64_t        start = 0;
+    uint64_t        end = 0;
+    uint64_t        time_base = 1;
+    const cue_track_value* values = nullptr; // 1 value per track
+    size_t          value_count = 0;
+};
+
+// Receives the cues, values are valid only during the call
+struct cue_visitor
+{
+    virtual ~cue_visitor() {}
+    virtual void Cue(const cue_struct& cue) = 0;
+};
+
+// Same as ConvertBuffer and ConvertFile, but cues are sent to visitor without formatting or allocating per cue
+// Cues are the same as in the WebVTT output, except that with merged cues the values of tc elements are compared as timecodes
+// Standard input is not supported
+int VisitBuffer(const char* buf, size_t len, const convert_options& options, cue_visitor& visitor, std::string& error);
+int VisitFile(const char* file_name, const convert_options& options, cue_visitor& visitor, std::string& error);
+
+// Frame to timecode index of 1 track, for reading the timecode of any frame without parsing the XML again
+// Content is in native byte order (only little-endian is supported) and used in place, e.g. from a memory mapped file:
+// 1 header then 1 segment per run of frames with timecodes incrementing by 1 per frame or per run of frames without timecode
+struct timecode_index_header
+{
+    char            magic[4];           // "TCIX"
+    uint32_t        version;
+    uint32_t        frame_rate_num;
+    uint32_t        frame_rate_den;
+    uint32_t        frames_max;         // FramesMax of the timecodes of the track
+    uint32_t        reserved;
+    uint64_t        frame_count;
+    uint64_t        segment_count;
+};
+
+enum timecode_index_flag
+{
+    timecode_index_has_value            = 1 << 0,
+    timecode_index_drop_frame           = 1 << 1,
+    timecode_index_1001                 = 1 << 2,
+    timecode_index_must_use_second_field= 1 << 3,
+    timecode_index_is_second_field      = 1 << 4,
+    timecode_index_negative             = 1 << 5,
+    timecode_index_is_time              = 1 << 6,
+};
+
+// Segments are sorted by first frame, the timecode is the timecode of the first frame of the segment
+struct timecode_index_segment
+{
+    uint64_t        first_frame;
+    uint32_t        hours;
+    uint32_t        frames;
+    uint32_t        frames_max;
+    uint8_t         minutes;
+    uint8_t         seconds;
+    uint8_t         flags;              // timecode_index_flag values
+    uint8_t         reserved;
+};
+
+// Builds the index of a track (track_index may be -1 if there is only 1 track), index is the content of the index file
+// Values which are not timecodes are indexed as frames without timecode, with a warning in error
+// Returns 0 if all fine, else 1 with the error messages in error
+int IndexBuffer(const char* buf, size_t len, size_t track_index, std::string& index, std::string& error);
+int IndexFile(const char* file_name, size_t track_index, std::string& index, std::string& error);
+
+// Read-only access to an index, the timecode of a frame is found with a binary search on the segments
+// and the frames having a timecode with a binary search on the segments sorted by timecode (built when the index is opened)
+struct timecode_index
+{
+    timecode_index();
+    ~timecode_index();
+    timecode_index(const timecode_index&) = delete;
+    timecode_index& operator=(const timecode_index&) = delete;
+
+    // Returns 0 if all fine, else 1 with the error messages in error
+    int Open(const char* buf, size_t len, std::string& error); // Buffer is not copied and must stay valid and 8-byte aligned
+    int OpenFile(const char* file_name, std::string& error);   // File is memory mapped if possible
+
+    uint64_t FrameCount() const { return header ? header->frame_count : 0; }
+    const timecode_index_header* Header() const { return header; }
+
+    // Returns true and the timecode if the frame has a timecode
+    bool Get(uint64_t frame, TimeCode& timecode) const;
+
+    // Returns true and the frames having the timecode (hours, minutes, seconds and frames are compared), in ascending order
+    // Timecodes wrap after 24 hours, so a timecode may be found several times in long runs
+    bool Find(const TimeCode& timecode, std::vector<uint64_t>& frames) const;
+
+private:
+    struct file_struct;
+    struct search_struct;
+    file_struct*                    file;
+    search_struct*                  search;
+    const timecode_index_header*    header;
+    const timecode_index_segment*   segments;
+};
+
+// Compact binary MediaTimecode, tc elements with timecodes incrementing by 1 per frame are stored as runs of packed timecodes
+// Conversion back to XML keeps the elements, the attributes (in the same order), their values and the comments, but not the XML
+// declaration, white spaces between elements and character references (values are escaped again when needed)
+// Binary content is also accepted as input by the Convert, Visit and Index functions, except from standard input
+// Returns 0 if all fine, else 1 with the error messages in error
+int XmlToBinary(const char* buf, size_t len, std::string& binary, std::string& error);
+int XmlFileToBinary(const char* file_name, std::string& binary, std::string& error);
+int BinaryToXml(const char* buf, size_t len, output_sink& output, std::string& error);
+int BinaryFileToXml(const char* file_name, output_sink& output, std::string& error);
+bool IsBinary(const char* buf, size_t len);
+
+} // namespace timecodexml
+
+#endif
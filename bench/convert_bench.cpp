@@ -0,0 +1,212 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+// Throughput of tfsxml parsing, TimeCode increment and formatting, and end-to-end conversion on generated documents
+
+#include "document.h"
+#include "../TimeCodeXml.h"
+#include "../tfsxml.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+using namespace timecodexml;
+
+struct null_sink : output_sink
+{
+    size_t          size = 0;
+
+    void Write(const char*, size_t size_) override { size += size_; }
+};
+
+struct counting_visitor : cue_visitor
+{
+    size_t          cue_count = 0;
+
+    void Cue(const cue_struct&) override { cue_count++; }
+};
+
+// Best time of the loops, in seconds
+template<typename F>
+static double Best(int loops, F func)
+{
+    double best = 0;
+    for (int i = 0; i < loops; i++) {
+        auto start = chrono::steady_clock::now();
+        func();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (!i || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+// Walks all elements and decodes all attribute values, returns the count of decoded values
+static size_t Parse(const string& doc, string& value)
+{
+    size_t count = 0;
+    tfsxml_string p, n, v;
+    if (tfsxml_init(&p, doc.data(), (tfsxml_size)doc.size())) {
+        return 0;
+    }
+    size_t level = 0;
+    for (;;) {
+        if (tfsxml_next(&p, &n)) {
+            if (!level || tfsxml_leave(&p)) {
+                break;
+            }
+            level--;
+            continue;
+        }
+        while (!tfsxml_attr(&p, &n, &v)) {
+            value.clear();
+            tfsxml_decode(value, v);
+            count++;
+        }
+        if (n.len && n.buf[0] != '?' && n.buf[0] != '!' && !tfsxml_enter(&p)) {
+            level++;
+        }
+    }
+    return count;
+}
+
+// Frames of a track stored as a start_tc
+static size_t IncrementAndFormat(const document_rate& rate, size_t frame_count)
+{
+    TimeCode timecode(0, 0, 0, 0, rate.frames_max, rate.drop_frame);
+    char value[TimeCode::ToString_MaxSize];
+    size_t size = 0;
+    for (size_t i = 0; i < frame_count; i++) {
+        size += timecode.ToString(value);
+        timecode++;
+    }
+    return size;
+}
+
+// Same with the values formatted in bulk
+static size_t FormatInBulk(const document_rate& rate, size_t frame_count, vector<char>& values, vector<size_t>& ends)
+{
+    TimeCode timecode(0, 0, 0, 0, rate.frames_max, rate.drop_frame);
+    return timecode.ToStrings(values.data(), frame_count, ends.data());
+}
+
+static int Run(const document_options& options, int loops)
+{
+    string doc;
+    MakeDocument(options, doc);
+    auto name = DocumentName(options);
+    auto mb = doc.size() / 1000000.0;
+
+    string value;
+    size_t value_count = 0;
+    auto parse_time = Best(loops, [&]() { value_count = Parse(doc, value); });
+    if (!value_count) {
+        fprintf(stderr, "Error: %s not parsed\n", name.c_str());
+        return 1;
+    }
+
+    convert_options convert;
+    counting_visitor visitor;
+    string error;
+    if (VisitBuffer(doc.data(), doc.size(), convert, visitor, error)) {
+        fprintf(stderr, "Error: %s not converted\n%s", name.c_str(), error.c_str());
+        return 1;
+    }
+    null_sink output;
+    auto convert_time = Best(loops, [&]() { error.clear(); output.size = 0; ConvertBuffer(doc.data(), doc.size(), convert, output, error); });
+
+    printf("%-34s: %8.1f MB, %9zu cues, tfsxml %7.1f MB/s, convert %7.1f MB/s %6.2f Mcues/s %7.1f MB/s output\n",
+        name.c_str(), mb, visitor.cue_count, mb / parse_time, mb / convert_time, visitor.cue_count / convert_time / 1000000, output.size / convert_time / 1000000);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    document_options options;
+    bool has_options = false;
+    int loops = 3;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--loops=", 8)) {
+            loops = atoi(argv[i] + 8);
+            continue;
+        }
+        if (!ParseDocumentOption(argv[i], options) || loops < 1) {
+            fprintf(stderr, "Usage: %s [--loops=N] [options]\n without options, a predefined set of documents is used\nOptions:\n%s", argv[0], DocumentOptionsUsage);
+            return 1;
+        }
+        has_options = true;
+    }
+    if (has_options) {
+        return Run(options, loops);
+    }
+
+    // Increment and formatting of timecodes, 10 minutes per rate
+    for (const auto& rate : document_rates) {
+        size_t frame_count = 600 * (rate.frames_max + 1);
+        size_t size = 0;
+        auto time = Best(loops, [&]() { size = IncrementAndFormat(rate, frame_count); });
+        printf("TimeCode %-5s ++ and ToString  : %9zu frames, %6.2f Mframes/s, %7.1f MB/s output\n", rate.name, frame_count, frame_count / time / 1000000, size / time / 1000000);
+        vector<char> values(frame_count * TimeCode::ToString_MaxSize);
+        vector<size_t> ends(frame_count);
+        time = Best(loops, [&]() { size = FormatInBulk(rate, frame_count, values, ends); });
+        printf("TimeCode %-5s ToStrings        : %9zu frames, %6.2f Mframes/s, %7.1f MB/s output\n", rate.name, frame_count, frame_count / time / 1000000, size / time / 1000000);
+    }
+
+    // Predefined documents, 1 hour of material or 8 hours of tracks
+    vector<document_options> documents;
+    for (size_t rate_index = 0; rate_index < sizeof(document_rates) / sizeof(document_rates[0]); rate_index++) {
+        for (int is_discrete = 0; is_discrete < 2; is_discrete++) {
+            document_options document;
+            document.rate_index = rate_index;
+            document.is_discrete = is_discrete;
+            document.duration = 3600;
+            documents.push_back(document);
+        }
+    }
+    for (size_t track_count : { 8, 32 }) {
+        for (int is_discrete = 0; is_discrete < 2; is_discrete++) {
+            document_options document;
+            document.track_count = track_count;
+            document.is_discrete = is_discrete;
+            document.duration = 3600 * 8 / track_count;
+            documents.push_back(document);
+        }
+    }
+    for (int is_discrete = 0; is_discrete < 2; is_discrete++) {
+        document_options document;
+        document.is_discrete = is_discrete;
+        document.has_entities = true;
+        document.duration = 3600;
+        documents.push_back(document);
+    }
+    for (const auto& document : documents) {
+        if (Run(document, loops)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Per-cue cost of the cue time stamps, CueTime vs the previous division based formatter
+
+#include "../CueTime.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+// Previous formatter, each time stamp is computed from the rational clock
+static void AddTimeStamp(string& content, uint64_t num, uint64_t den)
+{
+    auto before_comma = num / den;
+    auto after_comma = num % den;
+    after_comma = (after_comma * 1000 + den / 2) / den;
+    auto H10 = before_comma / 36000;
+    before_comma = before_comma % 36000;
+    content += to_string(H10);
+    auto H01 = (uint8_t)(before_comma / 3600);
+    before_comma = before_comma % 3600;
+    content += '0' + H01;
+    content += ':';
+    auto M10 = (uint8_t)(before_comma / 600);
+    before_comma = before_comma % 600;
+    content += '0' + M10;
+    auto M01 = (uint8_t)(before_comma / 60);
+    before_comma = before_comma % 60;
+    content += '0' + M01;
+    content += ':';
+    auto S10 = (uint8_t)(before_comma / 10);
+    before_comma = before_comma % 10;
+    content += '0' + S10;
+    auto S01 = (uint8_t)(before_comma);
+    content += '0' + S01;
+    content += '.';
+    auto m100 = (uint8_t)(after_comma / 100);
+    after_comma = after_comma % 100;
+    content += '0' + m100;
+    auto m010 = (uint8_t)(after_comma / 10);
+    after_comma = after_comma % 10;
+    content += '0' + m010;
+    auto m000 = (uint8_t)after_comma;
+    content += '0' + m000;
+}
+
+static double Legacy(string& output, size_t cue_count, uint64_t inc, uint64_t den)
+{
+    auto start = chrono::steady_clock::now();
+    uint64_t num = 0;
+    for (size_t i = 0; i < cue_count; i++) {
+        output.clear();
+        AddTimeStamp(output, num, den);
+        num += inc;
+        output += " --> ";
+        AddTimeStamp(output, num, den);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static double Current(string& output, size_t cue_count, uint64_t inc, uint64_t den)
+{
+    auto start = chrono::steady_clock::now();
+    CueTime time_stamp(0, inc, den);
+    for (size_t i = 0; i < cue_count; i++) {
+        output.clear();
+        output.append(time_stamp.data(), time_stamp.size());
+        time_stamp.Next();
+        output += " --> ";
+        output.append(time_stamp.data(), time_stamp.size());
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Checks that both formatters provide the same content, except the rounding to 1000 ms which was not handled
+static bool Check(size_t cue_count, uint64_t inc, uint64_t den)
+{
+    CueTime time_stamp(0, inc, den);
+    string legacy;
+    for (size_t i = 0; i < cue_count; i++) {
+        legacy.clear();
+        AddTimeStamp(legacy, i * inc, den);
+        if (legacy.compare(legacy.size() - 4, 4, ".:00")) {
+            if (legacy != string(time_stamp.data(), time_stamp.size())) {
+                fprintf(stderr, "Error: cue %zu, %s vs %.*s\n", i, legacy.c_str(), (int)time_stamp.size(), time_stamp.data());
+                return false;
+            }
+        }
+        time_stamp.Next();
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t cue_count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 25 * 3600 * 10;
+    struct rate { uint64_t inc; uint64_t den; const char* name; };
+    const rate rates[] = {
+        { 1, 25, "25" },
+        { 1001, 30000, "30000/1001" },
+        { 1, 50, "50" },
+        { 1001, 60000, "60000/1001" },
+    };
+
+    string output;
+    output.reserve(64);
+    for (const auto& r : rates) {
+        if (!Check(cue_count, r.inc, r.den)) {
+            return 1;
+        }
+        double legacy = Legacy(output, cue_count, r.inc, r.den);
+        double current = Current(output, cue_count, r.inc, r.den);
+        printf("cue time %-10s: %zu cues, legacy %.2f ns/cue, CueTime %.2f ns/cue\n",
+            r.name, cue_count, legacy * 1e9 / cue_count, current * 1e9 / cue_count);
+    }
+    return 0;
+}
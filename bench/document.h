@@ -0,0 +1,187 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Deterministic MediaTimecode documents for the benchmarks, the same options always provide the same document
+
+#ifndef BenchDocumentH
+#define BenchDocumentH
+
+#include "../TimeCode.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+struct document_rate
+{
+    const char*     name;               // Name in the options
+    const char*     frame_rate;         // frame_rate attribute
+    uint32_t        frames_max;
+    bool            drop_frame;
+};
+
+static const document_rate document_rates[] = {
+    { "25", "25", 24, false },
+    { "29.97", "30000/1001", 29, true },
+    { "50", "50", 49, false },
+    { "59.94", "60000/1001", 59, true },
+};
+
+struct document_options
+{
+    bool            is_discrete = false;    // 1 tc element per frame, else 1 start_tc per track
+    size_t          track_count = 1;
+    size_t          rate_index = 0;         // Index in document_rates
+    uint64_t        duration = 600;         // In seconds
+    bool            has_entities = false;   // Character references in attribute values
+};
+
+// Parses 1 command line option, returns false if the option is unknown or invalid
+static inline bool ParseDocumentOption(const char* arg, document_options& options)
+{
+    if (!strcmp(arg, "--discrete")) {
+        options.is_discrete = true;
+        return true;
+    }
+    if (!strcmp(arg, "--continuous")) {
+        options.is_discrete = false;
+        return true;
+    }
+    if (!strcmp(arg, "--entities")) {
+        options.has_entities = true;
+        return true;
+    }
+    if (!strncmp(arg, "--tracks=", 9)) {
+        options.track_count = strtoul(arg + 9, nullptr, 10);
+        return options.track_count >= 1 && options.track_count <= 32;
+    }
+    if (!strncmp(arg, "--duration=", 11)) {
+        options.duration = strtoull(arg + 11, nullptr, 10);
+        return options.duration >= 1 && options.duration <= 24 * 3600;
+    }
+    if (!strncmp(arg, "--rate=", 7)) {
+        for (size_t i = 0; i < sizeof(document_rates) / sizeof(document_rates[0]); i++) {
+            if (!strcmp(arg + 7, document_rates[i].name)) {
+                options.rate_index = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static const char* DocumentOptionsUsage =
+    " --continuous: 1 start_tc per track (default)\n"
+    " --discrete: 1 tc element per frame, with some discontinuities\n"
+    " --tracks=N: count of tracks, 1 to 32 (default is 1)\n"
+    " --rate=R: 25, 29.97 (drop frame), 50 or 59.94 (drop frame) (default is 25)\n"
+    " --duration=S: duration in seconds, up to 86400 (default is 600)\n"
+    " --entities: use character references in attribute values\n";
+
+// Summary of the options, e.g. "discrete 8x29.97 600s entities"
+static inline std::string DocumentName(const document_options& options)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s %zux%s %llus%s", options.is_discrete ? "discrete" : "continuous", options.track_count,
+        document_rates[options.rate_index].name, (unsigned long long)options.duration, options.has_entities ? " entities" : "");
+    return name;
+}
+
+static inline uint64_t DocumentFrameCount(const document_options& options)
+{
+    const auto& rate = document_rates[options.rate_index];
+    auto frame_count = options.duration * (rate.frames_max + 1);
+    if (rate.drop_frame) {
+        frame_count = frame_count * 1000 / 1001;
+    }
+    return frame_count;
+}
+
+// Appends the document to doc, if file is not null doc is written to file and cleared each time it is more than 1 MiB
+// Tracks start at different hours, discrete tracks have a discontinuity about every 2000 frames
+static inline void MakeDocument(const document_options& options, std::string& doc, FILE* file = nullptr)
+{
+    const auto& rate = document_rates[options.rate_index];
+    auto frame_count = DocumentFrameCount(options);
+    auto flush = [&]() {
+        if (file && doc.size() > (1 << 20)) {
+            fwrite(doc.data(), 1, doc.size(), file);
+            doc.clear();
+        }
+    };
+
+    doc +=
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<MediaTimecode xmlns=\"https://mediaarea.net/mediatimecode\" version=\"0.1\">\n";
+    doc += options.has_entities ? "<media ref=\"bench&amp;co.mxf\" format=\"MXF\" full=\"1\">\n" : "<media ref=\"bench.mxf\" format=\"MXF\" full=\"1\">\n";
+    uint32_t random = 1;
+    for (size_t i = 0; i < options.track_count; i++) {
+        TimeCode timecode((uint32_t)(i % 24), 0, 0, 0, rate.frames_max, rate.drop_frame);
+        doc += "<timecode_stream id=\"";
+        doc += std::to_string(i + 1);
+        doc += options.has_entities ? "\" source=\"VITC&amp;LTC\"" : "\"";
+        doc += " format=\"smpte-st377\" frame_rate=\"";
+        doc += rate.frame_rate;
+        doc += "\" frame_count=\"";
+        doc += std::to_string(frame_count);
+        if (!options.is_discrete) {
+            doc += "\" start_tc=\"";
+            doc += timecode.ToString();
+            doc += "\"/>\n";
+            continue;
+        }
+        doc += "\">\n";
+        for (uint64_t j = 0; j < frame_count; j++) {
+            random = random * 1103515245 + 12345;
+            bool is_discontinuity = j && !((random >> 16) % 2000);
+            if (is_discontinuity) {
+                timecode.FromFrames((random >> 8) % (24 * 3600 * (rate.frames_max + 1)));
+            }
+            char value[TimeCode::ToString_MaxSize];
+            auto value_size = timecode.ToString(value);
+            doc += "<tc v=\"";
+            if (options.has_entities) {
+                // Separator between hours and minutes as a character reference
+                doc.append(value, 2);
+                doc += "&#58;";
+                doc.append(value + 3, value_size - 3);
+            }
+            else {
+                doc.append(value, value_size);
+            }
+            doc += is_discontinuity ? "\" nc=\"1\"/>\n" : "\"/>\n";
+            timecode++;
+            flush();
+        }
+        doc += "</timecode_stream>\n";
+    }
+    doc +=
+        "</media>\n"
+        "</MediaTimecode>\n";
+    if (file) {
+        fwrite(doc.data(), 1, doc.size(), file);
+        doc.clear();
+    }
+}
+
+#endif
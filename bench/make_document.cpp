@@ -0,0 +1,48 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+// Writes a deterministic MediaTimecode document to standard output, e.g. as input of timecodexml2webvtt benchmarks
+
+#include "document.h"
+#include <cstdio>
+#include <string>
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    document_options options;
+    for (int i = 1; i < argc; i++) {
+        if (!ParseDocumentOption(argv[i], options)) {
+            fprintf(stderr, "Usage: %s [options] > file.xml\nOptions:\n%s", argv[0], DocumentOptionsUsage);
+            return 1;
+        }
+    }
+
+    string doc;
+    MakeDocument(options, doc, stdout);
+    if (fflush(stdout)) {
+        fprintf(stderr, "Error: can not write the document\n");
+        return 1;
+    }
+    return 0;
+}
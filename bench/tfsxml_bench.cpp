@@ -0,0 +1,110 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Throughput of the tfsxml scanning loops on a per-frame <tc> document
+
+#include "../tfsxml.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+static string MakeDocument(size_t frame_count)
+{
+    string doc =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<MediaTimecode xmlns=\"https://mediaarea.net/mediatimecode\" version=\"0.1\">\n"
+        "<media ref=\"bench.mxf\" format=\"MXF\" full=\"1\">\n"
+        "<timecode_stream id=\"1\" format=\"smpte-st377\" frame_rate=\"25\">\n";
+    char line[32];
+    for (size_t i = 0; i < frame_count; i++) {
+        auto s = i / 25;
+        snprintf(line, sizeof(line), "<tc v=\"%02u:%02u:%02u:%02u\"/>\n", (unsigned)(s / 3600 % 24), (unsigned)(s / 60 % 60), (unsigned)(s % 60), (unsigned)(i % 25));
+        doc += line;
+    }
+    doc +=
+        "</timecode_stream>\n"
+        "</media>\n"
+        "</MediaTimecode>\n";
+    return doc;
+}
+
+// Walks the document the same way timecodexml2webvtt does, returns the count of decoded values
+static size_t Parse(const string& doc, string& value)
+{
+    size_t count = 0;
+    tfsxml_string p, n, v;
+    if (tfsxml_init(&p, doc.data(), (tfsxml_size)doc.size())) {
+        return 0;
+    }
+    while (!tfsxml_next(&p, &n)) {
+        if (!tfsxml_strcmp_charp(n, "MediaTimecode")) {
+            tfsxml_enter(&p);
+            while (!tfsxml_next(&p, &n)) {
+                if (!tfsxml_strcmp_charp(n, "media")) {
+                    tfsxml_enter(&p);
+                    while (!tfsxml_next(&p, &n)) {
+                        if (!tfsxml_strcmp_charp(n, "timecode_stream")) {
+                            tfsxml_enter(&p);
+                            while (!tfsxml_next(&p, &n)) {
+                                while (!tfsxml_attr(&p, &n, &v)) {
+                                    value.clear();
+                                    tfsxml_decode(value, v);
+                                    count++;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t frame_count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 25 * 3600;
+    int loops = argc > 2 ? atoi(argv[2]) : 10;
+    auto doc = MakeDocument(frame_count);
+
+    string value;
+    double best = 0;
+    size_t count = 0;
+    for (int i = 0; i < loops; i++) {
+        auto start = chrono::steady_clock::now();
+        count = Parse(doc, value);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (!i || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    if (count != frame_count) {
+        fprintf(stderr, "Error: %zu values parsed, %zu expected\n", count, frame_count);
+        return 1;
+    }
+
+    printf("tfsxml: %zu bytes, %zu values, best of %d: %.3f ms, %.1f MB/s, %.1f Mvalues/s\n",
+        doc.size(), count, loops, best * 1000, doc.size() / best / 1000000, count / best / 1000000);
+    return 0;
+}
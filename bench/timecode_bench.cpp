@@ -0,0 +1,264 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+// Per-call cost of the TimeCode conversions called per frame, in ns and instructions per operation
+
+#include "../TimeCode.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// Count of instructions of the calling thread, not available if the system does not permit it
+class instruction_counter
+{
+public:
+    instruction_counter()
+    {
+        #ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        #endif
+    }
+    ~instruction_counter()
+    {
+        #ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+        #endif
+    }
+    bool IsAvailable() const { return fd >= 0; }
+    void Start()
+    {
+        #ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        #endif
+    }
+    uint64_t Stop()
+    {
+        uint64_t count = 0;
+        #ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+        #endif
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+struct rate
+{
+    const char*     name;
+    uint32_t        frames_max;
+    bool            drop_frame;
+    bool            must_use_second_field;
+};
+
+static const rate rates[] = {
+    { "24", 23, false, false },
+    { "25", 24, false, false },
+    { "30", 29, false, false },
+    { "29.97DF", 29, true, false },
+    { "48", 47, false, false },
+    { "50", 49, false, false },
+    { "60", 59, false, false },
+    { "59.94DF", 59, true, false },
+    { "100", 99, false, false },
+    { "120", 119, false, false },
+    { "119.88DF", 119, true, false },
+    { "25 fields", 24, false, true },
+    { "29.97DF fields", 29, true, true },
+};
+
+struct result
+{
+    double          ns = 0;
+    double          instructions = 0;
+};
+
+// Best of the loops, func runs count operations
+template<typename F>
+static result Measure(instruction_counter& counter, int loops, size_t count, F func)
+{
+    result best;
+    for (int i = 0; i < loops; i++) {
+        counter.Start();
+        auto start = chrono::steady_clock::now();
+        func();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        auto instructions = counter.Stop();
+        if (!i || elapsed.count() * 1e9 / count < best.ns) {
+            best.ns = elapsed.count() * 1e9 / count;
+            best.instructions = (double)instructions / count;
+        }
+    }
+    return best;
+}
+
+static volatile int64_t sink;
+
+int main(int argc, char* argv[])
+{
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    int loops = argc > 2 ? atoi(argv[2]) : 5;
+    if (!count || loops < 1) {
+        fprintf(stderr, "Usage: %s [operation_count [loops]]\n", argv[0]);
+        return 1;
+    }
+    instruction_counter counter;
+
+    static const char* operation_names[] = { "PlusOne", "MinusOne", "FromFrames", "ToFrames", "ToMilliseconds", "FromString", "Rate FromFrames", "Rate ToFrames", "Rate ToMs" };
+    printf("%-22s", counter.IsAvailable() ? "ns/op (instructions/op)" : "ns/op");
+    for (auto name : operation_names) {
+        printf(" %16s", name);
+    }
+    printf("\n");
+    for (const auto& r : rates) {
+        TimeCode start(10, 0, 0, 0, r.frames_max, r.drop_frame, r.must_use_second_field);
+        auto day_frame_count = TimeCode(24, 0, 0, 0, r.frames_max, r.drop_frame).ToFrames();
+
+        // Random frame numbers within 24 hours, and the corresponding timecodes and strings
+        vector<int64_t> frame_numbers(count);
+        vector<TimeCode> timecodes(count);
+        vector<string> strings(count);
+        uint32_t random = 1;
+        for (size_t i = 0; i < count; i++) {
+            random = random * 1103515245 + 12345;
+            frame_numbers[i] = (((uint64_t)random << 16) ^ (random >> 8)) % day_frame_count;
+            timecodes[i] = TimeCode(frame_numbers[i], r.frames_max, r.drop_frame, r.must_use_second_field, random & 0x100);
+            strings[i] = timecodes[i].ToString();
+        }
+
+        vector<result> operations;
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            TimeCode timecode = start;
+            for (size_t i = 0; i < count; i++) {
+                timecode.PlusOne();
+            }
+            sink = timecode.GetFrames();
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            TimeCode timecode = start;
+            for (size_t i = 0; i < count; i++) {
+                timecode.MinusOne();
+            }
+            sink = timecode.GetFrames();
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            TimeCode timecode = start;
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                timecode.FromFrames(frame_numbers[i]);
+                total += timecode.GetFrames();
+            }
+            sink = total;
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += timecodes[i].ToFrames();
+            }
+            sink = total;
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += timecodes[i].ToMilliseconds();
+            }
+            sink = total;
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            TimeCode timecode = start;
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                timecode.FromString(strings[i]);
+                total += timecode.GetFrames();
+            }
+            sink = total;
+        }));
+
+        // Same with the constants of the frame rate precomputed
+        TimeCodeRate timecode_rate(r.frames_max, r.drop_frame);
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            TimeCode timecode = start;
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                timecode_rate.FromFrames(timecode, frame_numbers[i]);
+                total += timecode.GetFrames();
+            }
+            sink = total;
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += timecode_rate.ToFrames(timecodes[i]);
+            }
+            sink = total;
+        }));
+        operations.push_back(Measure(counter, loops, count, [&]() {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += timecode_rate.ToMilliseconds(timecodes[i]);
+            }
+            sink = total;
+        }));
+
+        printf("%-22s", r.name);
+        for (const auto& o : operations) {
+            if (counter.IsAvailable()) {
+                printf(" %7.2f (%6.1f)", o.ns, o.instructions);
+            }
+            else {
+                printf(" %16.2f", o.ns);
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Checks of the command line, $1 is the timecodexml2webvtt executable, returns the count of failed checks
+
+tool=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+failed_count=0
+
+check() {
+    if ! eval "$1"; then
+        echo "$0: check failed: $1" >&2
+        failed_count=$((failed_count + 1))
+    fi
+}
+
+cat > "$dir/run.xml" <<'XML'
+<?xml version="1.0" encoding="UTF-8"?>
+<MediaTimecode xmlns="https://mediaarea.net/mediatimecode" version="0.1">
+<media ref="test.mxf">
+<timecode_stream id="1" format="smpte-st377" frame_rate="25" frame_count="7">
+<tc v="01:00:00:20"/>
+<tc v="01&#58;00:00:21" frame_count="5"/>
+<tc v="01:00:00:26"/>
+</timecode_stream>
+</media>
+</MediaTimecode>
+XML
+
+# Timecodes from the XML and from the index
+check '[ "$("$tool" --timecode=01:00:00:24 "$dir/run.xml")" = 4 ]'
+check '"$tool" --index="$dir/run.idx" "$dir/run.xml"'
+check '[ "$("$tool" --index="$dir/run.idx" --frame=3)" = 01:00:00:23 ]'
+check '[ "$("$tool" --index="$dir/run.idx" --timecode=01:00:00:24)" = 4 ]'
+
+# Corrupted index (frames_max of the first segment, after the 40-byte header, set to 0xFFFFFFFF), rejected instead of crashing
+cp "$dir/run.idx" "$dir/corrupted.idx"
+printf '\377\377\377\377' | dd of="$dir/corrupted.idx" bs=1 seek=56 conv=notrunc 2>/dev/null
+for query in --frame=5 --timecode=01:00:00:05; do
+    "$tool" --index="$dir/corrupted.idx" $query > /dev/null 2> "$dir/error.txt"
+    result=$?
+    check '[ $result = 1 ]'
+    check 'grep -q "index is truncated or corrupted" "$dir/error.txt"'
+done
+
+# Batch: an existing output file is kept when the conversion fails, several files with the same output file name are rejected
+echo 'not a timecode file' > "$dir/bad.xml"
+echo 'previous output' > "$dir/bad.vtt"
+check '! "$tool" --batch "$dir/bad.xml" 2> /dev/null'
+check '[ "$(cat "$dir/bad.vtt")" = "previous output" ] && [ ! -e "$dir/bad.vtt.tmp" ]'
+check '"$tool" --batch "$dir/run.xml" && grep -q "01:00:00:21" "$dir/run.vtt"'
+printf '%s\t%s\n%s\t%s\n' "$dir/run.xml" "$dir/same.vtt" "$dir/bad.xml" "$dir/same.vtt" > "$dir/list.txt"
+check '! "$tool" --batch="$dir/list.txt" 2> "$dir/error.txt" && grep -q "output file name of several files" "$dir/error.txt" && [ ! -e "$dir/same.vtt" ]'
+
+if [ $failed_count != 0 ]; then
+    echo "$failed_count check(s) failed" >&2
+    exit 1
+fi
+echo "All command line checks passed"
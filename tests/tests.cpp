@@ -0,0 +1,516 @@
+/* Copyright (c) MediaArea.net SARL. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Regression tests of the conversion, the cue visitor and the index, returns the count of failed checks
+
+#include "../TimeCodeXml.h"
+#include "../tfsxml.h"
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+using namespace timecodexml;
+
+static int failed_count = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failed_count++; \
+        } \
+    } while (0)
+
+struct string_sink : output_sink
+{
+    string          text;
+
+    void Write(const char* data, size_t size) override { text.append(data, size); }
+};
+
+struct counting_visitor : cue_visitor
+{
+    size_t          cue_count = 0;
+    uint64_t        end = 0;
+    uint64_t        time_base = 1;
+
+    void Cue(const cue_struct& cue) override
+    {
+        cue_count++;
+        end = cue.end;
+        time_base = cue.time_base;
+    }
+};
+
+static size_t CueCount(const string& vtt)
+{
+    size_t count = 0;
+    for (auto pos = vtt.find(" --> "); pos != string::npos; pos = vtt.find(" --> ", pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static string Document(const char* frame_rate, const char* frame_count, const char* content)
+{
+    string doc =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<MediaTimecode xmlns=\"https://mediaarea.net/mediatimecode\" version=\"0.1\">\n"
+        "<media ref=\"test.mxf\">\n"
+        "<timecode_stream id=\"1\" format=\"smpte-st377\" frame_rate=\"";
+    doc += frame_rate;
+    doc += "\" frame_count=\"";
+    doc += frame_count;
+    doc += "\">\n";
+    doc += content;
+    doc +=
+        "</timecode_stream>\n"
+        "</media>\n"
+        "</MediaTimecode>\n";
+    return doc;
+}
+
+// tc element with frame_count and a value with a character reference
+static const char* EncodedRun =
+    "<tc v=\"01:00:00:20\"/>\n"
+    "<tc v=\"01&#58;00:00:21\" frame_count=\"5\"/>\n"
+    "<tc v=\"01:00:00:26\"/>\n";
+
+static void TestEncodedRun()
+{
+    auto doc = Document("25", "7", EncodedRun);
+    string error;
+
+    string_sink vtt;
+    convert_options options;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), options, vtt, error));
+    CHECK(CueCount(vtt.text) == 7);
+
+    counting_visitor visitor;
+    CHECK(!VisitBuffer(doc.data(), doc.size(), options, visitor, error));
+    CHECK(visitor.cue_count == 7);
+    CHECK(visitor.end * 25 == visitor.time_base * 7);
+
+    // 01:00:00:20 to 01:00:01:00 then 01:00:00:26
+    string_sink merged_vtt;
+    options.merge = merge_segment;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), options, merged_vtt, error));
+    CHECK(CueCount(merged_vtt.text) == 2);
+    counting_visitor merged_visitor;
+    CHECK(!VisitBuffer(doc.data(), doc.size(), options, merged_visitor, error));
+    CHECK(merged_visitor.cue_count == 2);
+}
+
+// Index of the only track of a document
+struct test_index
+{
+    string          content;
+    vector<uint64_t> storage;           // Index buffers are used in place and must be 8-byte aligned
+    timecode_index  index;
+    string          error;
+
+    // Returns false if the index can not be built or opened
+    bool Build(const string& doc) { return !IndexBuffer(doc.data(), doc.size(), (size_t)-1, content, error) && Open(); }
+
+    bool Open()
+    {
+        storage.assign((content.size() + 7) / 8, 0);
+        memcpy(storage.data(), content.data(), content.size());
+        return !index.Open((const char*)storage.data(), content.size(), error);
+    }
+};
+
+static void TestEncodedRunIndex()
+{
+    auto doc = Document("25", "7", EncodedRun);
+    test_index test;
+    CHECK(test.Build(doc));
+    auto& index = test.index;
+
+    string_sink vtt;
+    string error;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), convert_options(), vtt, error));
+    CHECK(index.FrameCount() == CueCount(vtt.text));
+
+    TimeCode timecode;
+    CHECK(index.Get(3, timecode) && timecode.ToString() == "01:00:00:23");
+    CHECK(index.Get(5, timecode) && timecode.ToString() == "01:00:01:00");
+    CHECK(index.Get(6, timecode) && timecode.ToString() == "01:00:00:26");
+}
+
+// Segments with values the timecodes can not take or not sorted by frame are rejected
+static void TestCorruptedIndex()
+{
+    test_index test;
+    CHECK(test.Build(Document("25", "7", EncodedRun)));
+    if (test.content.size() < sizeof(timecode_index_header) + 2 * sizeof(timecode_index_segment)) {
+        return;
+    }
+    auto content = test.content;
+    auto open_patched = [&](const function<void(timecode_index_segment*)>& patch) {
+        test.content = content;
+        patch((timecode_index_segment*)&test.content[sizeof(timecode_index_header)]);
+        return test.Open();
+    };
+
+    CHECK(!open_patched([](timecode_index_segment* segments) { segments[0].frames_max = 0xFFFFFFFF; }));
+    CHECK(test.error == "Error: index is truncated or corrupted\n");
+    CHECK(!test.index.Header());
+    CHECK(!open_patched([](timecode_index_segment* segments) { segments[1].first_frame = 0; }));
+    CHECK(!open_patched([](timecode_index_segment* segments) { segments[1].first_frame = 7; }));
+    CHECK(open_patched([](timecode_index_segment*) {}));
+}
+
+// Same as --timecode with a file
+static void TestEncodedRunFind()
+{
+    test_index test;
+    CHECK(test.Build(Document("25", "7", EncodedRun)));
+    auto& index = test.index;
+    if (!index.Header()) {
+        return;
+    }
+
+    TimeCode timecode;
+    timecode.SetFramesMax(index.Header()->frames_max);
+    vector<uint64_t> frames;
+    CHECK(!timecode.FromString("01:00:00:24") && index.Find(timecode, frames) && frames == vector<uint64_t>{ 4 });
+    CHECK(!timecode.FromString("01:00:00:21") && index.Find(timecode, frames) && frames == vector<uint64_t>{ 1 });
+    CHECK(!timecode.FromString("01:00:00:25") && !index.Find(timecode, frames));
+}
+
+// Dropped frame numbers after a discontinuity have no position in the day, they are found by value
+static void TestDroppedFrameNumbersFind()
+{
+    test_index test;
+    CHECK(test.Build(Document("30000/1001", "6",
+        "<tc v=\"00:00:59;28\"/>\n"
+        "<tc v=\"00:01:00;00\"/>\n"
+        "<tc v=\"00:01:00;01\"/>\n"
+        "<tc v=\"00:01:00;02\"/>\n"
+        "<tc v=\"00:01:00;00\"/>\n"
+        "<tc v=\"00:01:00;03\"/>\n")));
+    auto& index = test.index;
+    if (!index.Header()) {
+        return;
+    }
+
+    TimeCode timecode;
+    timecode.SetFramesMax(index.Header()->frames_max);
+    vector<uint64_t> frames;
+    CHECK(!timecode.FromString("00:01:00;00") && index.Find(timecode, frames) && frames == (vector<uint64_t>{ 1, 4 }));
+    CHECK(!timecode.FromString("00:01:00;01") && index.Find(timecode, frames) && frames == vector<uint64_t>{ 2 });
+    CHECK(!timecode.FromString("00:01:00;02") && index.Find(timecode, frames) && frames == vector<uint64_t>{ 3 });
+    CHECK(!timecode.FromString("00:01:00;03") && index.Find(timecode, frames) && frames == vector<uint64_t>{ 5 });
+}
+
+// tc element with frame_count and a value which is not a timecode, the value is repeated
+static void TestNotTimeCodeRun()
+{
+    auto doc = Document("25", "6",
+        "<tc v=\"01:00:00:20\"/>\n"
+        "<tc v=\"n/a\" frame_count=\"4\"/>\n"
+        "<tc v=\"01:00:00:25\"/>\n");
+    string error;
+
+    string_sink vtt;
+    convert_options options;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), options, vtt, error));
+    CHECK(CueCount(vtt.text) == 6);
+    CHECK(vtt.text.find("00:00:00.160 --> 00:00:00.200\n                                       1: n/a\n") != string::npos);
+
+    counting_visitor visitor;
+    CHECK(!VisitBuffer(doc.data(), doc.size(), options, visitor, error));
+    CHECK(visitor.cue_count == 6);
+
+    test_index test;
+    CHECK(test.Build(doc));
+    CHECK(test.index.FrameCount() == 6);
+    TimeCode timecode;
+    CHECK(!test.index.Get(4, timecode));
+    CHECK(test.index.Get(5, timecode) && timecode.ToString() == "01:00:00:25");
+}
+
+// Negative, too big or not integer frame_count is an error, with the same output with 1 thread and with sharded tracks
+static void TestInvalidFrameCount()
+{
+    const char* frame_counts[] = {"-5", "99999999999999999999", "12a", "200000"};
+    for (auto frame_count : frame_counts) {
+        string continuous_doc =
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<MediaTimecode xmlns=\"https://mediaarea.net/mediatimecode\" version=\"0.1\">\n"
+            "<media ref=\"test.mxf\">\n"
+            "<timecode_stream id=\"1\" format=\"smpte-st377\" frame_rate=\"25\" start_tc=\"01:00:00:00\" frame_count=\"";
+        continuous_doc += frame_count;
+        continuous_doc +=
+            "\"/>\n"
+            "</media>\n"
+            "</MediaTimecode>\n";
+        string run = "<tc v=\"01:00:00:00\"/>\n<tc v=\"01:00:00:01\" frame_count=\"";
+        run += frame_count;
+        run += "\"/>\n<tc v=\"02:00:00:00\"/>\n";
+        auto run_doc = Document("25", "3", run.c_str());
+        bool is_valid = !strcmp(frame_count, "200000");
+
+        for (const auto& doc : {continuous_doc, run_doc}) {
+            string_sink vtts[2];
+            string errors[2];
+            int results[2];
+            size_t thread_counts[2] = {1, 4};
+            for (size_t i = 0; i < 2; i++) {
+                convert_options options;
+                options.thread_count = thread_counts[i];
+                results[i] = ConvertBuffer(doc.data(), doc.size(), options, vtts[i], errors[i]);
+            }
+            CHECK(results[0] == !is_valid);
+            CHECK(results[1] == results[0]);
+            CHECK(errors[1] == errors[0]);
+            CHECK(vtts[1].text == vtts[0].text);
+
+            counting_visitor visitor;
+            string error;
+            convert_options options;
+            CHECK(VisitBuffer(doc.data(), doc.size(), options, visitor, error) == !is_valid);
+        }
+    }
+}
+
+struct cue_length_visitor : cue_visitor
+{
+    size_t          empty_cue_count = 0;
+
+    void Cue(const cue_struct& cue) override { empty_cue_count += cue.end <= cue.start; }
+};
+
+// Decimal frame rates of N*1000/1001 fps are exact fractions, so both tracks are on the same time line
+static void TestDecimal1001Rates()
+{
+    string doc =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<MediaTimecode xmlns=\"https://mediaarea.net/mediatimecode\" version=\"0.1\">\n"
+        "<media ref=\"test.mxf\">\n"
+        "<timecode_stream id=\"1\" format=\"smpte-st377\" frame_rate=\"29.97\" frame_count=\"60\" start_tc=\"01:00:00;00\"/>\n"
+        "<timecode_stream id=\"2\" format=\"smpte-st377\" frame_rate=\"59.94\" frame_count=\"120\" start_tc=\"01:00:00;00\"/>\n"
+        "</media>\n"
+        "</MediaTimecode>\n";
+    string error;
+
+    string_sink vtt;
+    convert_options options;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), options, vtt, error));
+    CHECK(CueCount(vtt.text) == 120);
+    CHECK(vtt.text.find("00:00:00.033 --> 00:00:00.033") == string::npos);
+
+    cue_length_visitor visitor;
+    CHECK(!VisitBuffer(doc.data(), doc.size(), options, visitor, error));
+    CHECK(!visitor.empty_cue_count);
+}
+
+// Parser of a document, content is provided by blocks of block_size bytes in partial mode, else all at once
+struct block_parser
+{
+    const string&   doc;
+    size_t          block_size;
+    size_t          end;
+    tfsxml_string   p{};
+
+    block_parser(const string& doc_, size_t block_size_) : doc(doc_), block_size(block_size_), end(block_size_ ? min(block_size_, doc_.size()) : doc_.size()) {}
+
+    int Init()
+    {
+        if (!block_size) {
+            return tfsxml_init(&p, doc.data(), (tfsxml_size)end);
+        }
+        int result;
+        while ((result = tfsxml_init_partial(&p, doc.data(), (tfsxml_size)end)) == TFSXML_NEED_MORE_DATA && end < doc.size()) {
+            end = min(end + block_size, doc.size());
+        }
+        if (result == TFSXML_NEED_MORE_DATA) {
+            return tfsxml_init(&p, doc.data(), (tfsxml_size)end);
+        }
+        return result;
+    }
+
+    // Calls the function again with the next block while more content is needed
+    int Call(const function<int(tfsxml_string*)>& f)
+    {
+        int result;
+        while ((result = f(&p)) == TFSXML_NEED_MORE_DATA) {
+            end = min(end + block_size, doc.size());
+            auto offset = (size_t)(p.buf - doc.data());
+            tfsxml_feed(&p, doc.data() + offset, (tfsxml_size)(end - offset), end == doc.size());
+        }
+        return result;
+    }
+};
+
+// Names of the children of the root element, "error" if the parsing fails
+static string ChildNames(const string& doc, size_t block_size)
+{
+    block_parser parser(doc, block_size);
+    tfsxml_string n;
+    auto next = [&](tfsxml_string* p) { return tfsxml_next(p, &n); };
+    if (parser.Init() || parser.Call(next) || parser.Call(tfsxml_enter)) {
+        return "error";
+    }
+    string names;
+    while (!parser.Call(next)) {
+        names += tfsxml_decode(n);
+        names += ' ';
+    }
+    return names;
+}
+
+// Value of the root element, "error" if the parsing fails
+static string RootValue(const string& doc, size_t block_size)
+{
+    block_parser parser(doc, block_size);
+    tfsxml_string n, v;
+    if (parser.Init() || parser.Call([&](tfsxml_string* p) { return tfsxml_next(p, &n); }) || parser.Call([&](tfsxml_string* p) { return tfsxml_value(p, &v); })) {
+        return "error";
+    }
+    return tfsxml_decode(v);
+}
+
+// CDATA sections are skipped, including when empty or split between blocks
+static void TestCdata()
+{
+    string doc = "<a><![CDATA[]]><b/><![CDATA[x]]>]]><c/></a>";
+    CHECK(ChildNames(doc, 0) == "b c ");
+    for (size_t block_size = 1; block_size < doc.size(); block_size++) {
+        CHECK(ChildNames(doc, block_size) == "b c ");
+    }
+
+    string value = "<a><![CDATA[x<y]]></a>";
+    CHECK(RootValue(value, 0) == "x<y");
+    for (size_t block_size = 1; block_size < value.size(); block_size++) {
+        CHECK(RootValue(value, block_size) == "x<y");
+    }
+
+    // Truncated
+    string truncated = "<a><b/><![CDATA[";
+    CHECK(ChildNames(truncated, 0) == "b ");
+    for (size_t block_size = 1; block_size < truncated.size(); block_size++) {
+        CHECK(ChildNames(truncated, block_size) == "b ");
+    }
+    string truncated_value = "<a><![CDATA[x";
+    for (size_t block_size = 0; block_size < truncated_value.size(); block_size++) {
+        CHECK(RootValue(truncated_value, block_size) == "error");
+    }
+}
+
+// Binary MediaTimecode is converted back to the same elements, and converted and indexed the same way as the XML
+static void TestBinaryRoundTrip()
+{
+    // Runs of incrementing timecodes, a value which is not a timecode, an encoded value
+    string run =
+        "<tc v=\"01:00:00:20\"/>\n"
+        "<tc v=\"01:00:00:21\"/>\n"
+        "<tc v=\"01:00:00:22\"/>\n"
+        "<tc v=\"n/a\"/>\n"
+        "<tc v=\"a&amp;b\" frame_count=\"2\"/>\n"
+        "<tc v=\"01:00:00:24\"/>\n"
+        "<tc v=\"01:00:00:25\"/>\n";
+    run += EncodedRun;
+    auto doc = Document("25", "15", run.c_str());
+    doc.insert(doc.find("<media "), "<!-- comment -->\n");
+    string error;
+
+    string binary;
+    CHECK(!XmlToBinary(doc.data(), doc.size(), binary, error));
+    CHECK(IsBinary(binary.data(), binary.size()));
+    CHECK(!IsBinary(doc.data(), doc.size()));
+    CHECK(binary.size() < doc.size());
+
+    // Same elements, attributes and comments, so the binary content of the XML from the binary content is the same
+    string_sink xml;
+    CHECK(!BinaryToXml(binary.data(), binary.size(), xml, error));
+    CHECK(xml.text.find("<!-- comment -->") != string::npos);
+    CHECK(xml.text.find("v=\"a&amp;b\" frame_count=\"2\"") != string::npos);
+    string binary2;
+    CHECK(!XmlToBinary(xml.text.data(), xml.text.size(), binary2, error));
+    CHECK(binary2 == binary);
+
+    convert_options options;
+    string_sink vtt, binary_vtt;
+    CHECK(!ConvertBuffer(doc.data(), doc.size(), options, vtt, error));
+    CHECK(!ConvertBuffer(binary.data(), binary.size(), options, binary_vtt, error));
+    CHECK(CueCount(vtt.text) == 15);
+    CHECK(binary_vtt.text == vtt.text);
+
+    counting_visitor visitor, binary_visitor;
+    CHECK(!VisitBuffer(doc.data(), doc.size(), options, visitor, error));
+    CHECK(!VisitBuffer(binary.data(), binary.size(), options, binary_visitor, error));
+    CHECK(binary_visitor.cue_count == visitor.cue_count);
+    CHECK(binary_visitor.end == visitor.end);
+
+    string index, binary_index;
+    CHECK(!IndexBuffer(doc.data(), doc.size(), (size_t)-1, index, error));
+    CHECK(!IndexBuffer(binary.data(), binary.size(), (size_t)-1, binary_index, error));
+    CHECK(binary_index == index);
+
+    // Truncated binary content is rejected
+    string_sink truncated_xml;
+    CHECK(BinaryToXml(binary.data(), binary.size() - 1, truncated_xml, error));
+}
+
+// Callbacks written for the int length of previous versions of tfsxml still compile and receive the decoded value
+static void AppendInt(void* s, const char* buf, int len)
+{
+    ((string*)s)->append(buf, (size_t)len);
+}
+
+static void TestDecodeIntCallback()
+{
+    string doc = "<a v=\"x&amp;y&#58;z\"/>";
+    tfsxml_string p, n, v;
+    CHECK(!tfsxml_init(&p, doc.data(), (tfsxml_size)doc.size()));
+    CHECK(!tfsxml_next(&p, &n));
+    CHECK(!tfsxml_attr(&p, &n, &v));
+    string value;
+    tfsxml_decode(&value, &v, AppendInt);
+    CHECK(value == "x&y:z");
+}
+
+int main()
+{
+    TestEncodedRun();
+    TestEncodedRunIndex();
+    TestCorruptedIndex();
+    TestEncodedRunFind();
+    TestDroppedFrameNumbersFind();
+    TestDecimal1001Rates();
+    TestNotTimeCodeRun();
+    TestInvalidFrameCount();
+    TestBinaryRoundTrip();
+    TestCdata();
+    TestDecodeIntCallback();
+
+    if (failed_count) {
+        fprintf(stderr, "%d check(s) failed\n", failed_count);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
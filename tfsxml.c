@@ -21,6 +21,19 @@ SOFTWARE.
 */
 
 #include "tfsxml.h"
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TFSXML_SSE2
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        #include <immintrin.h>
+        #define TFSXML_AVX2 __attribute__((target("avx2")))
+    #elif defined(_MSC_VER)
+        #include <immintrin.h>
+        #include <intrin.h>
+        #define TFSXML_AVX2
+    #endif
+#endif
 #ifndef NULL
     #ifdef __cplusplus
         #define NULL 0
@@ -36,6 +49,7 @@ SOFTWARE.
  * priv flags :
  * 0: is inside an element header
  * 1: previous element is closed
+ * 4: buffer is partial, more content may be provided with tfsxml_feed
  */
 
 /*
@@ -64,11 +78,141 @@ static inline void next_char(tfsxml_string* priv)
     priv->len--;
 }
 
+static inline void next_chars(tfsxml_string* priv, tfsxml_size count)
+{
+    priv->buf += count;
+    priv->len -= count;
+}
+
+/*
+ * Delimiter scanning, return the offset of the first delimiter or len if there is none
+ */
+
+static inline tfsxml_size find_1(const char* buf, tfsxml_size len, char c)
+{
+    /* memchr is already vectorized by the C library */
+    const char* found = (const char*)memchr(buf, c, len);
+    return found ? found - buf : len;
+}
+
+static tfsxml_size find_2_c(const char* buf, tfsxml_size len, char c1, char c2)
+{
+    tfsxml_size i;
+    for (i = 0; i < len; i++)
+        if (buf[i] == c1 || buf[i] == c2)
+            break;
+    return i;
+}
+
+#ifdef TFSXML_SSE2
+static inline int first_bit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long pos;
+    _BitScanForward(&pos, mask);
+    return (int)pos;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static tfsxml_size find_2_sse2(const char* buf, tfsxml_size len, char c1, char c2)
+{
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    tfsxml_size i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(buf + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(d, v1), _mm_cmpeq_epi8(d, v2)));
+        if (mask)
+            return i + first_bit(mask);
+    }
+    return i + find_2_c(buf + i, len - i, c1, c2);
+}
+
+#ifdef TFSXML_AVX2
+TFSXML_AVX2 static tfsxml_size find_2_avx2(const char* buf, tfsxml_size len, char c1, char c2)
+{
+    const __m256i v1 = _mm256_set1_epi8(c1);
+    const __m256i v2 = _mm256_set1_epi8(c2);
+    tfsxml_size i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(buf + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(d, v1), _mm256_cmpeq_epi8(d, v2)));
+        if (mask)
+            return i + first_bit(mask);
+    }
+    return i + find_2_sse2(buf + i, len - i, c1, c2);
+}
+
+static int has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) /* OSXSAVE, XMM and YMM states */
+        return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif /* TFSXML_AVX2 */
+#endif /* TFSXML_SSE2 */
+
+/* Function pointer shared by all threads, accesses are atomic (relaxed ordering is enough, all threads select the same function) */
+typedef tfsxml_size (*find_2_func)(const char* buf, tfsxml_size len, char c1, char c2);
+#if defined(__GNUC__)
+    #define TFSXML_LOAD(p) __atomic_load_n(&(p), __ATOMIC_RELAXED)
+    #define TFSXML_STORE(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELAXED)
+#else
+    #define TFSXML_LOAD(p) (*(volatile find_2_func*)&(p)) /* Volatile aligned pointer accesses are atomic with MSVC */
+    #define TFSXML_STORE(p, v) (*(volatile find_2_func*)&(p) = (v))
+#endif
+static find_2_func find_2 = NULL;
+
+/* Runtime dispatch, done by the first init (if done concurrently, all threads select the same function) */
+static void find_2_select()
+{
+    find_2_func selected;
+    if (TFSXML_LOAD(find_2))
+        return;
+#if defined(TFSXML_AVX2)
+    selected = has_avx2() ? find_2_avx2 : find_2_sse2;
+#elif defined(TFSXML_SSE2)
+    selected = find_2_sse2;
+#else
+    selected = find_2_c;
+#endif
+    TFSXML_STORE(find_2, selected);
+}
+
+/* Skip content until a delimiter */
+static inline void skip_to_1(tfsxml_string* priv, char c)
+{
+    next_chars(priv, find_1(priv->buf, priv->len, c));
+}
+
+static inline void skip_to_2(tfsxml_string* priv, char c1, char c2)
+{
+    next_chars(priv, TFSXML_LOAD(find_2)(priv->buf, priv->len, c1, c2));
+}
+
+static int tfsxml_attr_internal(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v);
+static int tfsxml_leave_internal(tfsxml_string* priv);
+
 static inline int tfsxml_leave_element_header(tfsxml_string* priv)
 {
     /* Skip attributes */
     tfsxml_string n, v;
-    while (!tfsxml_attr(priv, &n, &v));
+    while (!tfsxml_attr_internal(priv, &n, &v));
 
     return 0;
 }
@@ -78,7 +222,7 @@ static inline int tfsxml_has_value(tfsxml_string* v)
 {
     int is_end = 0;
     const char* buf = v->buf;
-    int len = v->len;
+    tfsxml_size len = v->len;
     while (len && !is_end)
     {
         switch (*buf)
@@ -123,7 +267,7 @@ tfsxml_string tfsxml_strstr_charp(tfsxml_string a, const char* b)
     for (; a.len; a.buf++, a.len--)
     {
         const char* buf = a.buf;
-        int len = a.len;
+        tfsxml_size len = a.len;
         const char* bb = b;
         /* Compare char per char */
         for (; len && *bb; buf++, len--, bb++)
@@ -142,10 +286,25 @@ tfsxml_string tfsxml_strstr_charp(tfsxml_string a, const char* b)
     return a;
 }
 
-int tfsxml_init(tfsxml_string* priv, const void* buf, int len)
+/* Partial buffer: if the end of the buffer is reached, the result may change with more content */
+static inline int tfsxml_need_more_data(tfsxml_string* priv, const tfsxml_string* priv_bak)
+{
+    if (priv->len || !get_flag(priv, 4))
+        return 0;
+
+    /* Restoring the state before the call, the call will be done again after more content is provided */
+    *priv = *priv_bak;
+    return 1;
+}
+
+static int tfsxml_init_internal(tfsxml_string* priv, const void* buf, tfsxml_size len, int is_partial)
 {
     const char* buf_8 = (const char*)buf;
 
+    /* Content is needed for BOM and start detection */
+    if (is_partial && len <= 3)
+        return TFSXML_NEED_MORE_DATA;
+
     /* BOM detection */
     if (len > 3
         && (unsigned char)buf_8[0] == 0xEF
@@ -163,15 +322,41 @@ int tfsxml_init(tfsxml_string* priv, const void* buf, int len)
     }
 
     /* Init */
+    find_2_select();
     priv->buf = (const char*)buf;
     priv->len = len;
     priv->flags = 0;
     set_flag(priv, 1);
+    if (is_partial)
+        set_flag(priv, 4);
 
     return 0;
 }
 
-int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
+int tfsxml_init(tfsxml_string* priv, const void* buf, tfsxml_size len)
+{
+    return tfsxml_init_internal(priv, buf, len, 0);
+}
+
+int tfsxml_init_partial(tfsxml_string* priv, const void* buf, tfsxml_size len)
+{
+    return tfsxml_init_internal(priv, buf, len, 1);
+}
+
+void tfsxml_feed(tfsxml_string* priv, const void* buf, tfsxml_size len, int is_last)
+{
+    priv->buf = (const char*)buf;
+    priv->len = len;
+    if (is_last)
+        unset_flag(priv, 4);
+}
+
+tfsxml_size tfsxml_remain(const tfsxml_string* priv)
+{
+    return priv->len;
+}
+
+static int tfsxml_next_internal(tfsxml_string* priv, tfsxml_string* n)
 {
     int level;
 
@@ -180,7 +365,7 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
         return -1;
 
     /* Leaving previous element content if needed */
-    if (!get_flag(priv, 1) && tfsxml_leave(priv))
+    if (!get_flag(priv, 1) && tfsxml_leave_internal(priv))
         return -1;
 
     level = 0;
@@ -193,10 +378,7 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
             if (priv->len && *priv->buf == '?')
             {
                 n->buf = priv->buf;
-                while (priv->len && *priv->buf != '>')
-                {
-                    next_char(priv);
-                }
+                skip_to_1(priv, '>');
                 n->len = priv->buf - n->buf;
                 if (priv->len)
                     next_char(priv);
@@ -207,16 +389,22 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
             {
                 unsigned long long probe = 0;
                 int i;
-                for (i = 1; i < 8; i++)
+                if (priv->len < 8 && get_flag(priv, 4))
+                {
+                    /* Not enough content for the probe, more content is needed */
+                    next_chars(priv, priv->len);
+                    continue;
+                }
+                for (i = 1; i < 8 && i < priv->len; i++)
                 {
                     probe <<= 8;
                     probe |= priv->buf[i];
                 }
                 if (probe == 0x5B43444154415BULL) /* "[CDATA[" */
                 {
+                    /* Skipping "![CDATA[" then the content until "]]>", or until the end of the buffer if truncated (more content is needed in partial mode) */
                     probe = 0;
-                    priv->buf += 9;
-                    priv->len -= 9;
+                    next_chars(priv, 8);
                     while (priv->len)
                     {
                         probe &= 0xFFFF;
@@ -227,14 +415,14 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
                         priv->buf++;
                         priv->len--;
                     }
-                    break;
+                    continue; /* At the end of the section, or of the buffer */
                 }
                 n->buf = priv->buf;
                 if (priv->len >= 3 && priv->buf[1] == '-' && priv->buf[2] == '-')
                 {
-                    int len_sav = priv->len;
+                    tfsxml_size len_sav = priv->len;
                     const char* buf = priv->buf + 3;
-                    int len = priv->len - 3;
+                    tfsxml_size len = priv->len - 3;
                     probe = 0;
                     while (len)
                     {
@@ -254,19 +442,18 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
                         next_char(priv);
                     return 0;
                 }
-                while (priv->len && *priv->buf != '>')
-                    next_char(priv);
+                skip_to_1(priv, '>');
                 n->len = priv->buf - n->buf;
                 if (priv->len)
                     next_char(priv);
                 set_flag(priv, 1);
                 return 0;
             }
-            if (*priv->buf == '/')
+            if (priv->len && *priv->buf == '/')
             {
-                while (priv->len && *priv->buf != '>')
+                skip_to_1(priv, '>');
+                if (priv->len)
                     next_char(priv);
-                next_char(priv);
                 if (!level)
                 {
                     n->buf = NULL;
@@ -304,7 +491,9 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
             }
             level++;
             break;
-        default:;
+        default:
+            skip_to_1(priv, '<');
+            continue;
         }
         next_char(priv);
     }
@@ -315,7 +504,7 @@ int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
     return -1;
 }
 
-int tfsxml_attr(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
+static int tfsxml_attr_internal(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
 {
     if (!get_flag(priv, 0))
         return -1;
@@ -346,10 +535,7 @@ int tfsxml_attr(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
         {
             /* Attribute */
             n->buf = priv->buf;
-            while (priv->len && *priv->buf != '=')
-            {
-                next_char(priv);
-            }
+            skip_to_1(priv, '=');
             n->len = priv->buf - n->buf;
             if (!priv->len)
                 return -1;
@@ -357,15 +543,18 @@ int tfsxml_attr(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
         }
         {
             /* Value */
-            const char quote = *priv->buf;
+            char quote;
             if (!priv->len)
                 return -1;
+            quote = *priv->buf;
             next_char(priv);
             v->buf = priv->buf;
-            while (priv->len && *priv->buf != quote)
+            for (;;)
             {
-                if (*priv->buf == '&')
-                    set_flag(v, 0);
+                skip_to_2(priv, quote, '&');
+                if (!priv->len || *priv->buf == quote)
+                    break;
+                set_flag(v, 0);
                 next_char(priv);
             }
             v->len = priv->buf - v->buf;
@@ -388,10 +577,10 @@ int tfsxml_attr(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
 }
 
 
-int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
+static int tfsxml_value_internal(tfsxml_string* priv, tfsxml_string* v)
 {
     tfsxml_string priv_bak = *priv;
-    int len_sav;
+    tfsxml_size len_sav;
 
     /* Exiting previous element header analysis if needed */
     int is_first = 0;
@@ -416,6 +605,12 @@ int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
             set_flag(v, 0);
             break;
         case '<':
+            if (priv->len == len_sav && priv->len <= 8 && get_flag(priv, 4))
+            {
+                /* Not enough content for the probe, more content is needed */
+                next_chars(priv, priv->len);
+                return -1;
+            }
             if (priv->len == len_sav && priv->len > 8)
             {
                 unsigned long long probe = 0;
@@ -428,7 +623,7 @@ int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
                 if (probe == 0x215B43444154415BULL) /* "![CDATA[" */
                 {
                     const char* buf = priv->buf + 9;
-                    int len = priv->len - 9;
+                    tfsxml_size len = priv->len - 9;
                     probe = 0;
                     while (len)
                     {
@@ -440,6 +635,12 @@ int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
                         buf++;
                         len--;
                     }
+                    if (!len)
+                    {
+                        /* Truncated, more content is needed in partial mode */
+                        next_chars(priv, priv->len);
+                        return -1;
+                    }
                     v->buf = priv->buf;
                     v->len = len_sav - len;
                     if (v->len < priv->len)
@@ -461,10 +662,12 @@ int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
             if (is_first)
             {
                 unset_flag(priv, 1);
-                tfsxml_leave(priv);
+                tfsxml_leave_internal(priv);
             }
             return 0;
-        default:;
+        default:
+            skip_to_2(priv, '<', '&');
+            continue;
         }
         next_char(priv);
     }
@@ -480,7 +683,7 @@ int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
     return 0;
 }
 
-int tfsxml_enter(tfsxml_string* priv)
+static int tfsxml_enter_internal(tfsxml_string* priv)
 {
     /* Exiting previous element header analysis if needed */
     if (get_flag(priv, 0) && tfsxml_leave_element_header(priv))
@@ -494,7 +697,7 @@ int tfsxml_enter(tfsxml_string* priv)
     return 0;
 }
 
-int tfsxml_leave(tfsxml_string* priv)
+static int tfsxml_leave_internal(tfsxml_string* priv)
 {
     int level;
 
@@ -513,8 +716,7 @@ int tfsxml_leave(tfsxml_string* priv)
             {
                 if (!level)
                 {
-                    while (priv->len && *priv->buf != '>')
-                        next_char(priv);
+                    skip_to_1(priv, '>');
                     if (priv->len)
                         next_char(priv);
                     set_flag(priv, 1);
@@ -527,10 +729,7 @@ int tfsxml_leave(tfsxml_string* priv)
             }
             if (priv->len && *priv->buf == '?')
             {
-                while (priv->len && *priv->buf != '>')
-                {
-                    next_char(priv);
-                }
+                skip_to_1(priv, '>');
                 if (priv->len)
                     next_char(priv);
                 set_flag(priv, 1);
@@ -540,16 +739,22 @@ int tfsxml_leave(tfsxml_string* priv)
             {
                 unsigned long long probe = 0;
                 int i;
-                for (i = 1; i < 8; i++)
+                if (priv->len < 8 && get_flag(priv, 4))
+                {
+                    /* Not enough content for the probe, more content is needed */
+                    next_chars(priv, priv->len);
+                    continue;
+                }
+                for (i = 1; i < 8 && i < priv->len; i++)
                 {
                     probe <<= 8;
                     probe |= priv->buf[i];
                 }
                 if (probe == 0x5B43444154415BULL) /* "[CDATA[" */
                 {
+                    /* Skipping "![CDATA[" then the content until "]]>", or until the end of the buffer if truncated (more content is needed in partial mode) */
                     probe = 0;
-                    priv->buf += 9;
-                    priv->len -= 9;
+                    next_chars(priv, 8);
                     while (priv->len)
                     {
                         probe &= 0xFFFF;
@@ -565,8 +770,8 @@ int tfsxml_leave(tfsxml_string* priv)
                 if (priv->len >= 3 && priv->buf[1] == '-' && priv->buf[2] == '-')
                 {
                     const char* buf = priv->buf + 3;
-                    int len_sav = priv->len;
-                    int len = priv->len - 3;
+                    tfsxml_size len_sav = priv->len;
+                    tfsxml_size len = priv->len - 3;
                     probe = 0;
                     while (len)
                     {
@@ -585,8 +790,7 @@ int tfsxml_leave(tfsxml_string* priv)
                         next_char(priv);
                     break;
                 }
-                while (priv->len && *priv->buf != '>')
-                    next_char(priv);
+                skip_to_1(priv, '>');
                 if (priv->len)
                     next_char(priv);
                 break;
@@ -622,8 +826,8 @@ int tfsxml_leave(tfsxml_string* priv)
             if (!get_flag(priv, 1))
                 level++;
             break;
-        default:;
-            next_char(priv);
+        default:
+            skip_to_1(priv, '<');
         }
     }
 
@@ -632,17 +836,62 @@ int tfsxml_leave(tfsxml_string* priv)
     return 0;
 }
 
+int tfsxml_next(tfsxml_string* priv, tfsxml_string* n)
+{
+    tfsxml_string priv_bak = *priv;
+    int result = tfsxml_next_internal(priv, n);
+    if (tfsxml_need_more_data(priv, &priv_bak))
+        return TFSXML_NEED_MORE_DATA;
+    return result;
+}
+
+int tfsxml_attr(tfsxml_string* priv, tfsxml_string* n, tfsxml_string* v)
+{
+    tfsxml_string priv_bak = *priv;
+    int result = tfsxml_attr_internal(priv, n, v);
+    if (tfsxml_need_more_data(priv, &priv_bak))
+        return TFSXML_NEED_MORE_DATA;
+    return result;
+}
+
+int tfsxml_value(tfsxml_string* priv, tfsxml_string* v)
+{
+    tfsxml_string priv_bak = *priv;
+    int result = tfsxml_value_internal(priv, v);
+    if (tfsxml_need_more_data(priv, &priv_bak))
+        return TFSXML_NEED_MORE_DATA;
+    return result;
+}
+
+int tfsxml_enter(tfsxml_string* priv)
+{
+    tfsxml_string priv_bak = *priv;
+    int result = tfsxml_enter_internal(priv);
+    if (tfsxml_need_more_data(priv, &priv_bak))
+        return TFSXML_NEED_MORE_DATA;
+    return result;
+}
+
+int tfsxml_leave(tfsxml_string* priv)
+{
+    tfsxml_string priv_bak = *priv;
+    int result = tfsxml_leave_internal(priv);
+    if (tfsxml_need_more_data(priv, &priv_bak))
+        return TFSXML_NEED_MORE_DATA;
+    return result;
+}
+
 static const char* const tfsxml_decode_markup[2] =
 {
     "amp\0apos\0gt\0lt\0quot",
     "&'><\"",
 };
 
-void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void*, const char*, int))
+void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void*, const char*, tfsxml_size))
 {
     const char* buf_begin;
     const char* buf = v->buf;
-    int len = v->len;
+    tfsxml_size len = v->len;
 
     if (!(v->flags & 1))
     {
@@ -656,7 +905,7 @@ void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void*, const ch
         if (*buf == '&')
         {
             const char* buf_end = buf;
-            int len_end = len;
+            tfsxml_size len_end = len;
             while (len_end && *buf_end != ';')
             {
                 buf_end++;
@@ -665,7 +914,7 @@ void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void*, const ch
             if (len_end)
             {
                 const char* buf_beg = buf + 1;
-                int len_beg = buf_end - buf_beg;
+                tfsxml_size len_beg = buf_end - buf_beg;
                 if (len_beg && *buf_beg == '#')
                 {
                     unsigned long value = 0;
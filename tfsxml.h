@@ -5,6 +5,8 @@
 #ifndef TFSXML_H
 #define TFSXML_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -14,6 +16,12 @@ extern "C"
         Splitting of the XML content in blocks
 ------------------------------------------------------------------------- **/
 
+/** Length type used by the parser
+ *
+ * @note same size as a pointer, so buffers bigger than 2 GiB are supported on 64-bit platforms
+ */
+typedef ptrdiff_t tfsxml_size;
+
 /** Base structure for the parser
  *
  * @param buf  pointer to the buffer which has the data
@@ -25,7 +33,7 @@ extern "C"
     typedef struct tfsxml_string
 {
     const char* buf;
-    int         len;
+    tfsxml_size len;
     int         flags;
 } tfsxml_string;
 
@@ -37,7 +45,44 @@ extern "C"
  *
  * @note after init, priv should not be directly used (data may be something else than a buf/len pair)
  */
-int tfsxml_init(tfsxml_string* priv, const void* buf, int len);
+int tfsxml_init(tfsxml_string* priv, const void* buf, tfsxml_size len);
+
+/** Value returned when the end of a partial buffer is reached, see tfsxml_init_partial */
+#define TFSXML_NEED_MORE_DATA 1
+
+/** Initialize the parser with the beginning of the content, for content provided by blocks (e.g. from a pipe)
+ *
+ * @param priv  pointer to a tfsxml_string dedicated instance, private use by the parser
+ * @param buf  pointer to start of the buffer
+ * @param len  length of the buffer
+ *
+ * @return  0 if the content looks like XML
+ *          -1 if the content is not XML
+ *          TFSXML_NEED_MORE_DATA if the buffer is too small for detecting XML, call it again with more content
+ *
+ * @note other functions may then return TFSXML_NEED_MORE_DATA, nothing is consumed in that case and the same call
+ *       must be done again after the parser received more content with tfsxml_feed
+ */
+int tfsxml_init_partial(tfsxml_string* priv, const void* buf, tfsxml_size len);
+
+/** Provide more content to a parser initialized with tfsxml_init_partial
+ *
+ * @param priv  pointer to a tfsxml_string dedicated instance, private use by the parser
+ * @param buf  pointer to the content not yet consumed (the last tfsxml_remain() bytes of the previous buffer) followed by the new content
+ * @param len  length of the buffer
+ * @param is_last  1 if there is no more content after this buffer, else 0
+ *
+ * @note the previous buffer is not used anymore after this call, so consumed content can be discarded
+ */
+void tfsxml_feed(tfsxml_string* priv, const void* buf, tfsxml_size len, int is_last);
+
+/** Get the length of the content not yet consumed by the parser
+ *
+ * @param priv  pointer to a tfsxml_string dedicated instance, private use by the parser
+ *
+ * @return  count of bytes at the end of the buffer that are not yet consumed
+ */
+tfsxml_size tfsxml_remain(const tfsxml_string* priv);
 
 /** Get next element or other content except an element value
  *
@@ -106,7 +151,7 @@ int tfsxml_leave(tfsxml_string* priv);
  *
  * @note see tfsxml_decode_string C++ function for an example of usage
  */
-void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void* func_s, const char* func_buf, int func_len));
+void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void* func_s, const char* func_buf, tfsxml_size func_len));
 
 /** -------------------------------------------------------------------------
         Helper functions related to tfsxml_string
@@ -137,21 +182,45 @@ tfsxml_string tfsxml_strstr_charp(tfsxml_string a, const char* b);
 #ifdef __cplusplus
 #include <string>
 
-static void tfsxml_decode_string(void* d, const char* buf, int len) { ((std::string*)d)->append(buf, len); }
+static inline void tfsxml_decode_string(void* d, const char* buf, tfsxml_size len) { ((std::string*)d)->append(buf, len); }
 
 /** Convert encoded XML block (attribute or value) to real content (encoded in UTF-8)
  *
  * @param s  string which will be appended with the decoded content
  * @param b  XML content to decode
  */
-static void tfsxml_decode(std::string& s, const tfsxml_string& b) { tfsxml_decode(&s, &b, tfsxml_decode_string); }
+static inline void tfsxml_decode(std::string& s, const tfsxml_string& b) { tfsxml_decode(&s, &b, tfsxml_decode_string); }
 
 /** Convert encoded XML block (attribute or value) to real content (encoded in UTF-8)
  *
  * @param b  XML content to decode
  * @return  decoded content
  */
-static std::string tfsxml_decode(const tfsxml_string& b) { std::string s; tfsxml_decode(&s, &b, tfsxml_decode_string); return s; }
+static inline std::string tfsxml_decode(const tfsxml_string& b) { std::string s; tfsxml_decode(&s, &b, tfsxml_decode_string); return s; }
+
+/** Callback with an int length, as before tfsxml_size, kept for source compatibility */
+struct tfsxml_decode_int_struct
+{
+    void* s;
+    void (*func)(void* func_s, const char* func_buf, int func_len);
+};
+static inline void tfsxml_decode_int(void* d, const char* buf, tfsxml_size len)
+{
+    const tfsxml_decode_int_struct* data = (const tfsxml_decode_int_struct*)d;
+    const tfsxml_size int_max = 0x7FFFFFFF;
+    while (len > int_max) {
+        data->func(data->s, buf, (int)int_max);
+        buf += int_max;
+        len -= int_max;
+    }
+    data->func(data->s, buf, (int)len);
+}
+
+/** Same as tfsxml_decode with a callback having an int length, blocks bigger than 2 GiB are split
+ *
+ * @note new code should use a callback with a tfsxml_size length
+ */
+static inline void tfsxml_decode(void* s, const tfsxml_string* v, void (*func)(void* func_s, const char* func_buf, int func_len)) { tfsxml_decode_int_struct d = {s, func}; tfsxml_decode(&d, v, tfsxml_decode_int); }
 
 #endif /* __cplusplus */
 
@@ -20,311 +20,371 @@ SOFTWARE.
 
 */
 
-#include "tfsxml.h"
-#include "TimeCode.h"
+#include "TimeCodeXml.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <limits>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace std;
+using namespace timecodexml;
 
-struct stream_struct
+// Output file name of a batch item without output file name, the extension is replaced by .vtt
+string BatchOutputName(const string& input_name)
 {
-    tfsxml_string   xml_handle;
-    tfsxml_string   n;
-    string          id;
-    TimeCode        timecode;
-    long long       frame_count;
-};
-
-// Greatest common divisor (GCD) for uint64_t
-uint64_t gcd(uint64_t a, uint64_t b) {
-    while (b != 0) {
-        uint64_t t = b;
-        b = a % b;
-        a = t;
+    auto dot_pos = input_name.find_last_of('.');
+    auto slash_pos = input_name.find_last_of("/\\");
+    if (dot_pos == string::npos || (slash_pos != string::npos && dot_pos < slash_pos)) {
+        return input_name + ".vtt";
     }
-    return a;
+    return input_name.substr(0, dot_pos) + ".vtt";
 }
 
-bool ParseRational(const std::string& s, uint64_t& num, uint64_t& den) {
-    if (s.empty()) return false;
-
-    size_t pos = 0;
-    uint64_t n = 0;
-
-    // Parse integer part before '/' or '.'
-    try {
-        n = std::stoull(s, &pos);
-    }
-    catch (...) {
-        return false;
+// Converts each input file to its output file, files are converted in parallel
+// Each file is written with a temporary name then renamed, so an existing output file is replaced only by a complete conversion
+// Errors are reported per file, returns 0 if all files are converted
+int ConvertBatch(const vector<pair<string, string>>& items, const convert_options& options, size_t thread_count)
+{
+    // Files written by several items at the same time are rejected before any conversion
+    set<string> output_names;
+    for (const auto& item : items) {
+        if (!output_names.insert(item.second).second) {
+            cerr << "Error: " << item.second << " is the output file name of several files\n";
+            return 1;
+        }
     }
 
-    uint64_t d = 1;  // default denominator
-
-    // Fraction "a/b"
-    if (pos < s.size() && s[pos] == '/') {
-        try {
-            d = std::stoull(s.substr(pos + 1));
-        }
-        catch (...) {
-            return false;
+    mutex err_mutex;
+    size_t error_count = 0;
+    atomic<size_t> item_pos(0);
+    auto convert_items = [&]() {
+        for (size_t i; (i = item_pos++) < items.size();) {
+            const auto& item = items[i];
+            string error;
+            int result = 1;
+            if (item.first == "-") {
+                error = "Error: standard input is not supported in batch mode\n";
+            }
+            else if (item.first == item.second) {
+                error = "Error: output file name is the input file name\n";
+            }
+            else {
+                auto temporary_name = item.second + ".tmp";
+                ofstream out(temporary_name, ios_base::out | ios_base::binary | ios_base::trunc);
+                if (!out) {
+                    error = "Error: can not create " + temporary_name + '\n';
+                }
+                else {
+                    ostream_sink output(out);
+                    try {
+                        result = ConvertFile(item.first.c_str(), options, output, error);
+                    }
+                    catch (const exception& e) {
+                        error += string("Error: ") + e.what() + '\n';
+                        result = 1;
+                    }
+                    out.close();
+                    if (!result && out.fail()) {
+                        error += "Error: can not write " + item.second + '\n';
+                        result = 1;
+                    }
+                    if (!result) {
+                        #if defined(_WIN32)
+                        remove(item.second.c_str()); // rename does not replace an existing file
+                        #endif
+                        if (rename(temporary_name.c_str(), item.second.c_str())) {
+                            error += "Error: can not rename " + temporary_name + " to " + item.second + '\n';
+                            result = 1;
+                        }
+                    }
+                    if (result) {
+                        remove(temporary_name.c_str()); // No partial output, the previous output file if any is kept
+                    }
+                }
+            }
+            if (!result) {
+                continue;
+            }
+            istringstream lines(error);
+            string line;
+            lock_guard<mutex> lock(err_mutex);
+            error_count++;
+            while (getline(lines, line)) {
+                cerr << item.first << ": " << line << '\n';
+            }
         }
-        if (d == 0) return false;
+    };
+    vector<thread> workers;
+    for (size_t i = 1; i < thread_count && i < items.size(); i++) {
+        workers.emplace_back(convert_items);
     }
-    // Decimal "x.y"
-    else if (pos < s.size() && s[pos] == '.') {
-        uint64_t frac = 0;
-        uint64_t pow10 = 1;
-        for (size_t i = pos + 1; i < s.size(); ++i) {
-            char c = s[i];
-            if (c < '0' || c > '9') return false;
-            frac = frac * 10 + (c - '0');
-            pow10 *= 10;
-        }
-        n = n * pow10 + frac;
-        d = pow10;
+    convert_items();
+    for (auto& worker : workers) {
+        worker.join();
     }
-
-    // Reduce the fraction to lowest terms
-    uint64_t g = gcd(n, d);
-    num = n / g;
-    den = d / g;
-
-    return true;
+    if (error_count) {
+        cerr << error_count << " of " << items.size() << " files not converted\n";
+        return 1;
+    }
+    return 0;
 }
 
-void AddTimeStamp(string& content, uint64_t num, uint64_t den)
+// Outputs the frames having the timecode, returns 0 if the timecode is found
+int FindTimeCode(const timecode_index& index, const char* timecode_text)
 {
-    auto before_comma = num / den;
-    auto after_comma = num % den;
-    after_comma = (after_comma * 1000 + den / 2) / den;
-    auto H10 = before_comma / 36000;
-    before_comma = before_comma % 36000;
-    content += to_string(H10);
-    auto H01 = (uint8_t)(before_comma / 3600);
-    before_comma = before_comma % 3600;
-    content += '0' + H01;
-    content += ':';
-    auto M10 = (uint8_t)(before_comma / 600);
-    before_comma = before_comma % 600;
-    content += '0' + M10;
-    auto M01 = (uint8_t)(before_comma / 60);
-    before_comma = before_comma % 60;
-    content += '0' + M01;
-    content += ':';
-    auto S10 = (uint8_t)(before_comma / 10);
-    before_comma = before_comma % 10;
-    content += '0' + S10;
-    auto S01 = (uint8_t)(before_comma);
-    content += '0' + S01;
-    content += '.';
-    auto m100 = (uint8_t)(after_comma / 100);
-    after_comma = after_comma % 100;
-    content += '0' + m100;
-    auto m010 = (uint8_t)(after_comma / 10);
-    after_comma = after_comma % 10;
-    content += '0' + m010;
-    auto m000 = (uint8_t)after_comma;
-    content += '0' + m000;
+    TimeCode timecode;
+    timecode.SetFramesMax(index.Header()->frames_max);
+    if (timecode.FromString(timecode_text)) {
+        cerr << "Error: " << timecode_text << " is not a timecode\n";
+        return 1;
+    }
+    vector<uint64_t> frames;
+    if (!index.Find(timecode, frames)) {
+        cerr << "Error: timecode " << timecode_text << " not found\n";
+        return 1;
+    }
+    for (auto frame : frames) {
+        cout << frame << '\n';
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) 
 {
-    if (argc < 2 || argc > 3) {
+    vector<const char*> args;
+    convert_options options;
+    size_t thread_count = thread::hardware_concurrency();
+    bool is_batch = false;
+    const char* batch_list_name = nullptr;
+    const char* index_name = nullptr;
+    const char* frame = nullptr;
+    const char* timecode_text = nullptr;
+    const char* binary_name = nullptr;
+    bool is_to_xml = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--threads=", 10)) {
+            thread_count = strtoul(argv[i] + 10, nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--batch")) {
+            is_batch = true;
+        }
+        else if (!strncmp(argv[i], "--batch=", 8)) {
+            is_batch = true;
+            batch_list_name = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "--index=", 8)) {
+            index_name = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "--frame=", 8)) {
+            frame = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "--timecode=", 11)) {
+            timecode_text = argv[i] + 11;
+        }
+        else if (!strncmp(argv[i], "--to-binary=", 12)) {
+            binary_name = argv[i] + 12;
+        }
+        else if (!strcmp(argv[i], "--to-xml")) {
+            is_to_xml = true;
+        }
+        else if (!strcmp(argv[i], "--merge=none")) {
+            options.merge = merge_none;
+        }
+        else if (!strcmp(argv[i], "--merge=second")) {
+            options.merge = merge_second;
+        }
+        else if (!strcmp(argv[i], "--merge=segment")) {
+            options.merge = merge_segment;
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    bool is_usage_error;
+    if (is_batch) {
+        is_usage_error = args.empty() && !batch_list_name;
+    }
+    else if (frame) {
+        is_usage_error = !index_name || !args.empty() || timecode_text;
+    }
+    else if (timecode_text && index_name) {
+        is_usage_error = !args.empty();
+    }
+    else if (binary_name || is_to_xml) {
+        is_usage_error = args.size() != 1 || (binary_name && is_to_xml) || !strcmp(args[0], "-");
+    }
+    else {
+        is_usage_error = args.empty() || args.size() > 2 || (args[0][0] == '-' && args[0][1]);
+    }
+    if (is_usage_error) {
         cout <<
             "Usage: \n"
-            << argv[0] << " file_name [track_index]\n"
-            " file_name: Timecode XML file from MediaInfo\n"
+            << argv[0] << " [options] file_name [track_index]\n"
+            << argv[0] << " [options] --batch file_name [file_name...]\n"
+            << argv[0] << " [options] --batch=list_file_name\n"
+            << argv[0] << " --index=index_file_name file_name [track_index]\n"
+            << argv[0] << " --index=index_file_name --frame=frame_number\n"
+            << argv[0] << " --timecode=timecode file_name [track_index]\n"
+            << argv[0] << " --index=index_file_name --timecode=timecode\n"
+            << argv[0] << " --to-binary=binary_file_name file_name\n"
+            << argv[0] << " --to-xml binary_file_name\n"
+            " file_name: Timecode XML file from MediaInfo, - for standard input\n"
             " track_index: 0-based track index for outputting only 1 track\n"
+            " list_file_name: file with 1 line per file to convert, - for standard input\n"
+            "  line is the input file name, optionally followed by a tab and the output file name\n"
+            "Options:\n"
+            " --merge=none: 1 cue per frame (default)\n"
+            " --merge=second: 1 cue per second, or less if a timecode does not increment by 1 per frame\n"
+            " --merge=segment: 1 cue per segment of timecodes incrementing by 1 per frame\n"
+            " --threads=N: count of threads computing the values of the tracks, or converting files in batch mode (default is the count of cores)\n"
+            " --batch: convert each file to a file with the same name and the .vtt extension, unless another name is in the list file\n"
+            " --index: build the frame to timecode index of a track, or read the timecode of a frame from the index with --frame\n"
+            " --timecode: output the 0-based numbers of the frames having this timecode, from the file or from the index\n"
+            " --to-binary: convert the XML file to a compact binary file, which is accepted as input file_name too\n"
+            " --to-xml: convert the binary file back to XML\n"
             ;
         return 1;
     }
-    size_t track_index = argc > 2 ? stoul(argv[2]) : (size_t) - 1;
-    ifstream input_file(argv[1], ios_base::in | ios_base::ate | ios_base::binary);
-    auto input_size = input_file.tellg();
-    if (input_size <= 0 || (size_t)input_size > numeric_limits<size_t>::max()) {
-        cerr << "Error: input file too big\n";
-        return 1;
+
+    if (is_batch) {
+        vector<pair<string, string>> items;
+        for (auto arg : args) {
+            items.emplace_back(arg, BatchOutputName(arg));
+        }
+        if (batch_list_name) {
+            ifstream list_file;
+            bool is_stdin = !strcmp(batch_list_name, "-");
+            if (!is_stdin) {
+                list_file.open(batch_list_name);
+                if (!list_file) {
+                    cerr << "Error: can not read " << batch_list_name << '\n';
+                    return 1;
+                }
+            }
+            istream& list = is_stdin ? cin : list_file;
+            string line;
+            while (getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                auto tab_pos = line.find('\t');
+                if (tab_pos == string::npos) {
+                    items.emplace_back(line, BatchOutputName(line));
+                }
+                else {
+                    items.emplace_back(line.substr(0, tab_pos), line.substr(tab_pos + 1));
+                }
+            }
+        }
+        return ConvertBatch(items, options, thread_count);
     }
-    input_file.seekg(0);
-    auto input = new char[input_size];
-    if (input_file.read(input, input_size).fail()) {
-        cerr << "Error: can not read the file in full\n";
-        return 1;
+
+    if (binary_name) {
+        string binary;
+        string error;
+        auto result = XmlFileToBinary(args[0], binary, error);
+        cerr << error;
+        if (result) {
+            return result;
+        }
+        ofstream out(binary_name, ios_base::out | ios_base::binary | ios_base::trunc);
+        out.write(binary.data(), (streamsize)binary.size());
+        out.close();
+        if (out.fail()) {
+            cerr << "Error: can not write " << binary_name << '\n';
+            remove(binary_name);
+            return 1;
+        }
+        return 0;
     }
-    input_file.close();
 
-    tfsxml_string xml_handle, n, v;
-    if (tfsxml_init(&xml_handle, input, (int)input_size)) {
-        cerr << "Error: issue when parsing the XML input file\n";
-        return 1;
+    if (is_to_xml) {
+        ostream_sink output(cout);
+        string error;
+        auto result = BinaryFileToXml(args[0], output, error);
+        cerr << error;
+        return result;
     }
-    uint64_t time_stamp_inc = 0;
-    uint64_t time_stamp_den = 0;
-    vector<stream_struct> streams;
-    string output;
-    size_t stream_pos = 0;
-    while (!tfsxml_next(&xml_handle, &n)) {
-        if (!tfsxml_strcmp_charp(n, "MediaTimecode")) {
-            tfsxml_enter(&xml_handle);
-            while (!tfsxml_next(&xml_handle, &n)) {
-                if (!tfsxml_strcmp_charp(n, "media")) {
-                    output += "WEBVTT\n";
-                    tfsxml_enter(&xml_handle);
-                    while (!tfsxml_next(&xml_handle, &n)) {
-                        if (!tfsxml_strcmp_charp(n, "timecode_stream")) {
-                            if (track_index != -1 && track_index != stream_pos++) {
-                                continue;
-                            }
-                            output += "\nNOTE";
-                            stream_struct stream;
-                            while (!tfsxml_attr(&xml_handle, &n, &v)) {
-                                output += ' ';
-                                output += tfsxml_decode(n);
-                                output += '=';
-                                auto value = tfsxml_decode(v);
-                                output += value;
-                                if (!tfsxml_strcmp_charp(n, "frame_count")) {
-                                    stream.frame_count = atoll(value.c_str());
-                                }
-                                if (!tfsxml_strcmp_charp(n, "frame_rate")) {
-                                    uint64_t new_frame_rate_num, new_frame_rate_den;
-                                    if (!ParseRational(value, new_frame_rate_num, new_frame_rate_den)) {
-                                        cerr << "Error: issue when parsing the frame_rate attribute " << value << '\n';
-                                    }
 
-                                    // Handle "rounded" 1/1.001 fractions
-                                    if (value.find('.') != string::npos) {
-                                        if (new_frame_rate_den == 100) {
-                                            if (new_frame_rate_num == 2997) {
-                                                new_frame_rate_num = 30000;
-                                                new_frame_rate_den = 1001;
-                                            }
-                                            if (new_frame_rate_num == 2398) {
-                                                new_frame_rate_num = 24000;
-                                                new_frame_rate_den = 1001;
-                                            }
-                                        }
-                                        if (new_frame_rate_den == 1000) {
-                                            if (new_frame_rate_num == 2997) {
-                                                new_frame_rate_num = 30000;
-                                                new_frame_rate_den++;
-                                            }
-                                            if (new_frame_rate_num == 23976) {
-                                                new_frame_rate_num = 24000;
-                                                new_frame_rate_den = 1001;
-                                            }
-                                        }
-                                    }
+    if (timecode_text && !index_name) {
+        if (!strcmp(args[0], "-")) {
+            cerr << "Error: standard input is not supported for searching a timecode\n";
+            return 1;
+        }
+        string index_content;
+        string error;
+        timecode_index index;
+        auto result = IndexFile(args[0], args.size() > 1 ? stoul(args[1]) : (size_t)-1, index_content, error);
+        if (!result) {
+            error.clear(); // Warnings about the values are not relevant here
+            result = index.Open(index_content.data(), index_content.size(), error);
+        }
+        if (result) {
+            cerr << error;
+            return result;
+        }
+        return FindTimeCode(index, timecode_text);
+    }
 
-                                    if (!time_stamp_inc && !time_stamp_den) {
-                                        time_stamp_den = new_frame_rate_num;
-                                        time_stamp_inc = new_frame_rate_den;
-                                    }
-                                    if (new_frame_rate_num != time_stamp_den || new_frame_rate_den != time_stamp_inc)
-                                    {
-                                        cerr << "Error: frame rate is not same for all tracks: " << new_frame_rate_num << '/' << new_frame_rate_den << " vs " << time_stamp_den << '/' << time_stamp_inc << '\n';
-                                        return 1;
-                                    }
-                                    auto FramesMax = new_frame_rate_num / new_frame_rate_den - (new_frame_rate_num % new_frame_rate_den == 0);
-                                    if (FramesMax > numeric_limits<uint32_t>::max()) {
-                                        return 1;
-                                    }
-                                    stream.timecode.SetFramesMax((uint32_t)FramesMax);
-                                }
-                                if (!tfsxml_strcmp_charp(n, "source")) {
-                                    stream.id = value;
-                                }
-                                if (!tfsxml_strcmp_charp(n, "id")) {
-                                    if (track_index == -1 && stream.id.empty()) {
-                                        stream.id = value;
-                                    }
-                                }
-                                if (!tfsxml_strcmp_charp(n, "start_tc")) {
-                                    stream.timecode.FromString(value);
-                                }
-                            }
-                            if (!stream.timecode.GetIsValid()) {
-                                stream.xml_handle = xml_handle;
-                                if (tfsxml_enter(&stream.xml_handle)) {
-                                    cerr << "Error: issue when parsing the XML input file\n";
-                                    return 1;
-                                }
-                                if (tfsxml_next(&stream.xml_handle, &stream.n)) {
-                                    cerr << "Error: issue when parsing the XML input file\n";
-                                    return 1;
-                                }
-                            }
-                            if (track_index == -1) {
-                                if (stream.id.size() < 40) {
-                                    stream.id.insert(stream.id.begin(), 40 - stream.id.size(), ' ');
-                                }
-                            }
-                            stream.id.insert(stream.id.begin(), 1, '\n');
-                            if (track_index == -1) {
-                                stream.id += ": ";
-                            }
-                            streams.push_back(stream);
-                        }
-                    }
-                }
-            }
+    if (frame || timecode_text) {
+        timecode_index index;
+        string error;
+        if (index.OpenFile(index_name, error)) {
+            cerr << error;
+            return 1;
         }
+        if (timecode_text) {
+            return FindTimeCode(index, timecode_text);
+        }
+        TimeCode timecode;
+        if (!index.Get(strtoull(frame, nullptr, 10), timecode)) {
+            cerr << "Error: no timecode at frame " << frame << '\n';
+            return 1;
+        }
+        cout << timecode.ToString() << '\n';
+        return 0;
     }
-    if (!time_stamp_inc || !time_stamp_den) {
-        cerr << "Error: frame rate is missing\n";
-        return 1;
+
+    if (args.size() > 1) {
+        options.track_index = stoul(args[1]);
     }
 
-    output += "\n"
-        "\n"
-        "::cue {\n"
-        "    color: white;\n"
-        "    background - color: black;\n"
-        "    font - family: monospace;\n"
-        "};\n"
-        "\n";
-    uint64_t time_stamp_num = 0;
-    auto active_stream_count = streams.size();
-    while (active_stream_count) {
-        output += '\n';
-        AddTimeStamp(output, time_stamp_num, time_stamp_den);
-        time_stamp_num += time_stamp_inc;
-        output += " --> ";
-        AddTimeStamp(output, time_stamp_num, time_stamp_den);
-        for (auto& stream : streams) {
-            output += stream.id;
-            if (stream.timecode.GetIsValid()) {
-                if (stream.frame_count) {
-                    output += stream.timecode.ToString();
-                    stream.timecode++;
-                    stream.frame_count--;
-                    if (!stream.frame_count) {
-                        active_stream_count--;
-                    }
-                }
-            }
-            else if (stream.n.len) {
-                if (!tfsxml_strcmp_charp(stream.n, "tc")) {
-                    while (!tfsxml_attr(&stream.xml_handle, &stream.n, &v)) {
-                        if (!tfsxml_strcmp_charp(stream.n, "v")) {
-                            tfsxml_decode(output, v);
-                        }
-                    }
-                }
-                if (tfsxml_next(&stream.xml_handle, &stream.n)) {
-                    active_stream_count--;
-                }
-            }
+    if (index_name) {
+        string index;
+        string error;
+        if (!strcmp(args[0], "-")) {
+            cerr << "Error: standard input is not supported for indexing\n";
+            return 1;
         }
-        output += '\n';
+        auto result = IndexFile(args[0], options.track_index, index, error);
+        cerr << error;
+        if (result) {
+            return result;
+        }
+        ofstream out(index_name, ios_base::out | ios_base::binary | ios_base::trunc);
+        out.write(index.data(), (streamsize)index.size());
+        out.close();
+        if (out.fail()) {
+            cerr << "Error: can not write " << index_name << '\n';
+            remove(index_name);
+            return 1;
+        }
+        return 0;
     }
-    delete[] input;
-
-    cout << output;
-    return 0;
+    options.thread_count = thread_count;
+    ostream_sink output(cout);
+    string error;
+    auto result = ConvertFile(args[0], options, output, error);
+    cerr << error;
+    return result;
 }
+